@@ -1,5 +1,28 @@
 #include "benchmark.hpp"
 
+#include "rate_limiter.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <deque>
+#include <limits>
+
+#define NANOS_PER_SEC (1000ULL * 1000ULL * 1000ULL)
+
+// Only the first errors are printed, a fault injecting server would
+// otherwise have the harness measure its own logging
+#define MAX_PRINTED_ERRORS 10
+
+struct PacedRequest {
+  PacedRequest(Benchmark* benchmark, uv_sem_t* window)
+    : benchmark(benchmark)
+    , window(window) { }
+
+  Benchmark* benchmark;
+  uv_sem_t* window;
+  Request request;
+};
+
 Benchmark::Benchmark(CassSession* session, const Config& config,
                      const std::string& query, size_t parameter_count,
                      bool is_threaded)
@@ -7,28 +30,57 @@ Benchmark::Benchmark(CassSession* session, const Config& config,
   , query_(query)
   , parameter_count_(parameter_count)
   , data_(generate_data(config.data_size))
+  , prepared_(NULL)
+  , prepared_cache_(NULL)
   , config_(config)
   , is_threaded_(is_threaded)
-  , barrier_(is_threaded_ ? config.num_threads : 1) { }
+  , barrier_(is_threaded_ ? config.num_threads : 1)
+  , concurrency_limit_(0)
+  , num_printed_errors_(0)
+  , measure_start_(0)
+  , measure_end_(std::numeric_limits<uint64_t>::max())
+  , stop_time_(0)
+  , end_time_(0)
+  , num_primed_keys_(0)
+  , priming_secs_(0.0) { }
 
 Benchmark::~Benchmark() {
-  if (prepared_) {
+  if (prepared_ && !prepared_cache_) {
     cass_prepared_free(prepared_);
   }
 }
 
 void Benchmark::setup() {
-  if (config_.use_prepared) {
-    if (prepare_query(session_, query_.c_str(), &prepared_) != 0) {
+  if (operations_.empty()) {
+    add_operation(config_.type);
+  }
+  if (config_.use_prepared && !query_.empty()) {
+    if (prepared_cache_) {
+      prepared_ = prepared_cache_->get(query_);
+    } else if (prepare_query(session_, query_.c_str(), &prepared_) != 0) {
       exit(-1);
     }
   }
   on_setup();
 }
 
+void Benchmark::prime() {
+  uint64_t start = uv_hrtime();
+  num_primed_keys_ = on_prime();
+  priming_secs_ = (uv_hrtime() - start) / (1000.0 * 1000.0 * 1000.0);
+}
+
 void Benchmark::run() {
-  if (is_threaded_) {
-    threads_.resize(config_.num_threads);
+  measure_start_ = uv_hrtime() + config_.warmup * NANOS_PER_SEC;
+  if (config_.duration > 0) {
+    measure_end_ = measure_start_ + config_.duration * NANOS_PER_SEC;
+    stop_time_ = measure_end_ + config_.cooldown * NANOS_PER_SEC;
+  }
+
+  // Paced runs always submit from their own threads so that sleeping until
+  // the next intended send time never blocks the sampling loop
+  if (is_threaded_ || config_.target_rate > 0) {
+    threads_.resize(num_threads());
     for (auto& thread : threads_) {
       uv_thread_create(&thread, on_thread, this);
     }
@@ -38,7 +90,21 @@ void Benchmark::run() {
 }
 
 bool Benchmark::poll(uint64_t timeout_ms) {
-  return barrier_.wait(timeout_ms);
+  if (barrier_.wait(timeout_ms)) {
+    return true;
+  }
+  if (end_time_ == 0) {
+    end_time_ = uv_hrtime();
+  }
+  return false;
+}
+
+double Benchmark::measured_secs() const {
+  uint64_t end_time = std::min(end_time_ != 0 ? end_time_ : uv_hrtime(), measure_end_);
+  if (end_time <= measure_start_) {
+    return 0.0;
+  }
+  return static_cast<double>(end_time - measure_start_) / NANOS_PER_SEC;
 }
 
 void Benchmark::join() {
@@ -49,12 +115,201 @@ void Benchmark::join() {
 
 void Benchmark::on_thread(void* arg) {
   Benchmark* test = static_cast<Benchmark*>(arg);
-  test->on_run();
+  if (test->config_.target_rate > 0) {
+    test->run_paced();
+  } else {
+    test->on_run();
+  }
+}
+
+void Benchmark::run_paced() {
+  RateLimiter rate_limiter(static_cast<double>(config_.target_rate) / num_threads());
+
+  // Bounds the number of in-flight requests. A request that has to wait for
+  // a slot still has its latency measured from its intended send time so
+  // that stalls are not hidden by coordinated omission.
+  uv_sem_t window;
+  uv_sem_init(&window, config_.num_concurrent_requests);
+
+  for (int i = num_requests(); i > 0 && is_running(); --i) {
+    uint64_t intended_time = rate_limiter.acquire();
+    uv_sem_wait(&window);
+
+    PacedRequest* paced = new PacedRequest(this, &window);
+    start(&paced->request, intended_time);
+    set_callback(&paced->request, on_paced_result, paced);
+  }
+
+  // Drain the outstanding requests
+  for (int i = 0; i < config_.num_concurrent_requests; ++i) {
+    uv_sem_wait(&window);
+  }
+  uv_sem_destroy(&window);
+
+  notify_done();
+}
+
+void Benchmark::on_paced_result(CassFuture* future, void* data) {
+  PacedRequest* paced = static_cast<PacedRequest*>(data);
+  paced->benchmark->finish(&paced->request);
+  uv_sem_post(paced->window);
+  delete paced;
+}
+
+int Benchmark::num_threads() const {
+  return is_threaded_ ? config_.num_threads : 1;
+}
+
+int Benchmark::num_requests() const {
+  if (config_.duration > 0) {
+    return std::numeric_limits<int>::max();
+  }
+  return config_.num_requests / num_threads();
+}
+
+void Benchmark::operation_latencies(size_t operation, Histogram* histogram) const {
+  operations_[operation]->latencies.snapshot(histogram);
+}
+
+void Benchmark::operation_execute_times(size_t operation, Histogram* histogram) const {
+  operations_[operation]->execute_times.snapshot(histogram);
+}
+
+void Benchmark::operation_errors(size_t operation, Histogram* histogram) const {
+  operations_[operation]->errors.snapshot(histogram);
+}
+
+void Benchmark::latencies(Histogram* histogram) const {
+  for (const auto& operation : operations_) {
+    operation->latencies.snapshot(histogram);
+  }
+}
+
+void Benchmark::errors(Histogram* histogram) const {
+  for (const auto& operation : operations_) {
+    operation->errors.snapshot(histogram);
+  }
+}
+
+void Benchmark::interval_latencies(Histogram* histogram) {
+  for (const auto& operation : operations_) {
+    operation->latencies.interval(histogram);
+  }
+}
+
+void Benchmark::interval_errors(Histogram* histogram) {
+  for (const auto& operation : operations_) {
+    operation->errors.interval(histogram);
+  }
+}
+
+size_t Benchmark::add_operation(const std::string& name) {
+  operations_.push_back(std::unique_ptr<Operation>(new Operation(name)));
+  return operations_.size() - 1;
+}
+
+void Benchmark::start(Request* request, uint64_t start_time) const {
+  request->start_time = start_time;
+  if (!config_.use_null_driver) {
+    request->future = execute(request);
+    return;
+  }
+
+  uint64_t execute_start = uv_hrtime();
+  request->future = execute(request);
+  if (execute_start >= measure_start_ && execute_start < measure_end_) {
+    operations_[request->operation]->execute_times.record(uv_hrtime() - execute_start);
+  }
+}
+
+void Benchmark::finish(Request* request) {
+  // Taken before the result is verified so that only the request is timed
+  uint64_t now = uv_hrtime();
+  CassError rc = request->future ? check_result(*request) : CASS_OK;
+  if (now >= measure_start_ && now < measure_end_) {
+    Operation* operation = operations_[request->operation].get();
+    (rc == CASS_OK ? operation->latencies : operation->errors).record(now - request->start_time);
+  }
+  if (rc != CASS_OK) {
+    int num_printed = num_printed_errors_.fetch_add(1, std::memory_order_relaxed);
+    if (num_printed < MAX_PRINTED_ERRORS) {
+      print_error(request->future);
+    } else if (num_printed == MAX_PRINTED_ERRORS) {
+      fprintf(stderr, "Further errors are only counted\n");
+    }
+  }
+  if (request->future) {
+    cass_future_free(request->future);
+    request->future = NULL;
+  }
+}
+
+void Benchmark::set_callback(Request* request, CassFutureCallback callback, void* data) const {
+  if (!config_.use_null_driver) {
+    cass_future_set_callback(request->future, callback, data);
+    return;
+  }
+
+  // A callback usually starts the thread's next request, so the completions
+  // are run from a queue rather than recursing for every request
+  static thread_local std::deque<std::pair<CassFutureCallback, void*> > completions;
+  static thread_local bool is_completing = false;
+  completions.push_back(std::make_pair(callback, data));
+  if (is_completing) {
+    return;
+  }
+  is_completing = true;
+  while (!completions.empty()) {
+    std::pair<CassFutureCallback, void*> completion(completions.front());
+    completions.pop_front();
+    completion.first(NULL, completion.second);
+  }
+  is_completing = false;
+}
+
+CassFuture* Benchmark::execute(Request* request) const {
+  return execute_statement(create_statement());
+}
+
+CassFuture* Benchmark::execute_statement(CassStatement* statement) const {
+  CassFuture* future = NULL;
+  if (!config_.use_null_driver) {
+    future = cass_session_execute(session_, statement);
+  }
+  cass_statement_free(statement);
+  return future;
+}
+
+CassFuture* Benchmark::execute_batch(CassBatch* batch) const {
+  CassFuture* future = NULL;
+  if (!config_.use_null_driver) {
+    future = cass_session_execute_batch(session_, batch);
+  }
+  cass_batch_free(batch);
+  return future;
+}
+
+CassStatement* Benchmark::new_statement() const {
+  if (prepared_ != NULL) {
+    return cass_prepared_bind(prepared_);
+  }
+  return cass_statement_new(query_.c_str(), parameter_count_);
+}
+
+CassStatement* Benchmark::create_statement() const {
+  CassStatement* statement = new_statement();
+  cass_statement_set_is_idempotent(statement, cass_true);
+  bind_params(statement);
+  return statement;
 }
 
-int Benchmark::num_requests() {
-  if (is_threaded_) {
-    return config_.num_requests / threads_.size();
+CassError Benchmark::check_result(const Request& request) const {
+  CassFuture* future = request.future;
+  CassError rc = cass_future_error_code(future);
+  if (rc == CASS_OK) {
+    const CassResult* result = cass_future_get_result(future);
+    verify_result(result);
+    cass_result_free(result);
   }
-  return config_.num_requests;
+  return rc;
 }
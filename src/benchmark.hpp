@@ -4,13 +4,30 @@
 #include "barrier.hpp"
 #include "config.hpp"
 #include "driver.hpp"
+#include "histogram.hpp"
+#include "latency_recorder.hpp"
+#include "prepared_cache.hpp"
 #include "utils.hpp"
 
 #include <uv.h>
 
+#include <atomic>
+#include <memory>
 #include <string>
 #include <vector>
 
+// The state of a single request from submission to completion
+struct Request {
+  Request()
+    : future(NULL)
+    , operation(0)
+    , start_time(0) { }
+
+  CassFuture* future;
+  size_t operation;
+  uint64_t start_time;
+};
+
 class Benchmark {
 public:
   Benchmark(CassSession* session, const Config& config,
@@ -19,43 +36,154 @@ public:
 
   virtual ~Benchmark();
 
+  // The number of statements each request carries (e.g. a batch's size)
+  virtual int statements_per_request() const { return 1; }
+
+  // Statements are prepared through the cache when one is set
+  void set_prepared_cache(PreparedCache* cache) { prepared_cache_ = cache; }
+
   void setup();
+  void prime();
   void run();
   bool poll(uint64_t timeout_ms);
   void join();
 
+  // The number of rows written by prime() and the time it took
+  int64_t num_primed_keys() const { return num_primed_keys_; }
+  double priming_secs() const { return priming_secs_; }
+
+  // Only requests completing in the steady-state window, after --warmup and
+  // before --cooldown, are recorded. Runs bounded by --num-requests measure
+  // from the end of the warmup until the last request completes.
+  double measured_secs() const;
+  bool is_steady_state(uint64_t start_time, uint64_t end_time) const {
+    return start_time >= measure_start_ && end_time <= measure_end_;
+  }
+
+  // Results are tracked per operation. Most workloads perform a single
+  // operation, mixed workloads perform one per statement type. Latencies
+  // are timed by the harness from submission to completion (or from the
+  // intended send time when running at a fixed --target-rate) and are
+  // independent of the driver's own metrics.
+  size_t num_operations() const { return operations_.size(); }
+  const std::string& operation_name(size_t operation) const { return operations_[operation]->name; }
+  void operation_latencies(size_t operation, Histogram* histogram) const;
+  // Failed requests are kept out of the latencies and throughput, their
+  // latencies are recorded separately
+  void operation_errors(size_t operation, Histogram* histogram) const;
+  // The time it took to create (and bind) each request, only recorded with
+  // --use-null-driver
+  void operation_execute_times(size_t operation, Histogram* histogram) const;
+  void latencies(Histogram* histogram) const;
+  void errors(Histogram* histogram) const;
+
+  // The total in-flight request limit of all threads when the concurrency
+  // adapts (--use-adaptive-concurrency)
+  int concurrency_limit() const { return concurrency_limit_.load(); }
+
+  // Latencies of all operations since the previous call. Meant for a single
+  // sampling thread; recording threads never wait on it.
+  void interval_latencies(Histogram* histogram);
+  void interval_errors(Histogram* histogram);
+
+  // The number of threads submitting requests
+  int num_threads() const;
+
+  // Starts a single request (filling in its future and operation). Workloads
+  // that send something other than one bound statement per request (e.g.
+  // batches) override this.
+  virtual CassFuture* execute(Request* request) const;
+  // Verifies a successful result, the error is reported by finish()
+  virtual CassError check_result(const Request& request) const;
+
 protected:
   virtual void on_setup() { } // Optional
+  virtual int64_t on_prime() { return 0; } // Optional, returns the number of rows written
   virtual void on_run() = 0;
 
+  virtual void bind_params(CassStatement* statement) const = 0;
+  virtual void verify_result(const CassResult* result) const = 0;
+
 private:
+  struct Operation {
+    Operation(const std::string& name)
+      : name(name) { }
+
+    const std::string name;
+    LatencyRecorder latencies;
+    LatencyRecorder errors;
+    LatencyRecorder execute_times;
+  };
+
   static void on_thread(void* arg);
 
+  void run_paced();
+  static void on_paced_result(CassFuture* future, void* data);
+
 protected:
   CassSession* session() const { return session_; }
   const std::string& query() const { return query_; }
   size_t parameter_count() const { return parameter_count_; }
   const std::string& data() const { return data_; }
   const CassPrepared* prepared() const { return prepared_; }
+  PreparedCache* prepared_cache() const { return prepared_cache_; }
   const Config& config() const { return config_; }
 
-  int num_requests();
+  int num_requests() const;
+
+  // Whether new requests should still be started. Runs bounded by
+  // --duration stop once the cooldown has passed (their num_requests() is
+  // effectively unbounded).
+  bool is_running() const {
+    return stop_time_ == 0 || uv_hrtime() < stop_time_;
+  }
+
+  size_t add_operation(const std::string& name);
+
+  void start(Request* request, uint64_t start_time) const;
+  void finish(Request* request);
+
+  // Calls "callback" once the request completes. With --use-null-driver
+  // requests complete as soon as they're started.
+  void set_callback(Request* request, CassFutureCallback callback, void* data) const;
+
+  CassStatement* new_statement() const;
+  CassStatement* create_statement() const;
+
+  // Sends a request, or only frees it and returns NULL with --use-null-driver
+  // so that the harness is measured without the driver
+  CassFuture* execute_statement(CassStatement* statement) const;
+  CassFuture* execute_batch(CassBatch* batch) const;
 
 protected:
   void notify_done() {
     barrier_.notify();
   }
 
+  void add_concurrency_limit(int delta) {
+    concurrency_limit_.fetch_add(delta);
+  }
+
 private:
   CassSession* const session_;
   const std::string query_;
   const size_t parameter_count_;
   const std::string data_;
   const CassPrepared* prepared_;
+  PreparedCache* prepared_cache_;
   const Config& config_;
   const bool is_threaded_;
   Barrier barrier_;
+  std::atomic<int> concurrency_limit_;
+  std::atomic<int> num_printed_errors_;
   std::vector<uv_thread_t> threads_;
+  std::vector<std::unique_ptr<Operation> > operations_;
+  uint64_t measure_start_;
+  uint64_t measure_end_;
+  uint64_t stop_time_;
+  uint64_t end_time_;
+  int64_t num_primed_keys_;
+  double priming_secs_;
 };
 
 #endif // BENCHMARK_HPP
@@ -4,89 +4,74 @@
 
 CallbackBenchmark::CallbackBenchmark(CassSession* session, const Config& config,
                                      const std::string& query, size_t parameter_count)
-  : Benchmark(session, config, query, parameter_count, false)
-  , request_count_(num_requests())
-  , count_(0)
-  , outstanding_count_(0) {
-  uv_mutex_init(&mutex_);
-}
-
-CallbackBenchmark::~CallbackBenchmark() {
-  uv_mutex_destroy(&mutex_);
+  : Benchmark(session, config, query, parameter_count, true)
+  , next_shard_(0) {
+  for (int i = 0; i < num_threads(); ++i) {
+    shards_.push_back(std::unique_ptr<Shard>(
+                        new Shard(this, num_requests(),
+                                  std::min(num_requests(), config.num_concurrent_requests))));
+  }
 }
 
 void CallbackBenchmark::on_run() {
-  for (int i = 0; i < std::min(request_count_, config().num_concurrent_requests); ++i) {
-    uv_mutex_lock(&mutex_);
-    if (count_++ < request_count_) {
-      outstanding_count_++;
-      uv_mutex_unlock(&mutex_);
-      run_query();
+  Shard* shard = shards_[next_shard_++].get();
+
+  if (shard->slots.empty()) {
+    notify_done();
+    return;
+  }
+
+  for (auto& slot : shard->slots) {
+    if (shard->take_ticket()) {
+      run_query(&slot);
     } else {
-      uv_mutex_unlock(&mutex_);
-      break;
+      retire(shard);
     }
   }
 }
 
-void CallbackBenchmark::run_query() {
-  CassFuture* future;
-  CassStatement* statement;
-  if (prepared()) {
-    statement = cass_prepared_bind(prepared());
-  } else {
-    statement = cass_statement_new(query().c_str(), parameter_count());
-  }
-  cass_statement_set_is_idempotent(statement, cass_true);
-  bind_params(statement);
-  future = cass_session_execute(session(), statement);
-  cass_future_set_callback(future, on_result, this);
-  cass_future_free(future);
-  cass_statement_free(statement);
+void CallbackBenchmark::run_query(Slot* slot) {
+  start(&slot->request, uv_hrtime());
+  set_callback(&slot->request, on_result, slot);
 }
 
 void CallbackBenchmark::on_result(CassFuture* future, void* data) {
-  CallbackBenchmark* benchmark = static_cast<CallbackBenchmark*>(data);
-  benchmark->handle_result(future);
+  Slot* slot = static_cast<Slot*>(data);
+  slot->shard->benchmark->handle_result(slot);
 }
 
-void CallbackBenchmark::handle_result(CassFuture* future) {
-  CassError rc = cass_future_error_code(future);
-  if (rc != CASS_OK) {
-    print_error(future);
+void CallbackBenchmark::handle_result(Slot* slot) {
+  Shard* shard = slot->shard;
+
+  finish(&slot->request);
+
+  if (shard->take_ticket()) {
+    run_query(slot);
   } else {
-    const CassResult* result = cass_future_get_result(future);
-    verify_result(result);
-    cass_result_free(result);
+    retire(shard);
   }
+}
 
-  uv_mutex_lock(&mutex_);
-  bool is_done = --outstanding_count_ == 0;
-  if (count_++ < request_count_) {
-    outstanding_count_++;
-    uv_mutex_unlock(&mutex_);
-    run_query();
-  } else {
-    uv_mutex_unlock(&mutex_);
-    if (is_done) {
-      notify_done();
-    }
+void CallbackBenchmark::retire(Shard* shard) {
+  if (shard->remaining_count.fetch_sub(1) == 1) {
+    notify_done();
   }
 }
 
 SelectCallbackBenchmark::SelectCallbackBenchmark(CassSession* session, const Config& config)
   : CallbackBenchmark(session, config, SELECT_QUERY, 1)
-  , index_(0) { }
+  , key_space_(config.key_seed)
+  , key_distribution_(KeyDistribution::create(config)) { }
 
-void SelectCallbackBenchmark::on_setup() {
-  partition_keys_.reserve(config().num_partition_keys);
-  for (int i = 0; i < config().num_partition_keys; ++i) {
-    partition_keys_.push_back(prime_select_query_data(session(), data()));
-  }
+int64_t SelectCallbackBenchmark::on_prime() {
+  prime_select_query_data(session(), key_space_, config().num_partition_keys, data(),
+                          config().num_threads, config().num_concurrent_requests);
+  return config().num_partition_keys;
 }
 
 void SelectCallbackBenchmark::bind_params(CassStatement* statement) const {
-  cass_statement_bind_uuid(statement, 0, partition_keys_[index_++ % partition_keys_.size()]);
+  uint64_t index = key_distribution_->next(config().num_partition_keys);
+  cass_statement_bind_uuid(statement, 0, key_space_.key(index));
 }
 
 void SelectCallbackBenchmark::verify_result(const CassResult* result) const {
@@ -2,48 +2,83 @@
 #define CALLBACK_BENCHMARK_HPP
 
 #include "benchmark.hpp"
+#include "key_distribution.hpp"
+#include "key_space.hpp"
 
 #include <atomic>
+#include <memory>
+#include <vector>
 
 class CallbackBenchmark : public Benchmark {
 public:
   CallbackBenchmark(CassSession* session, const Config& config,
                     const std::string& query, size_t parameter_count);
-  ~CallbackBenchmark();
 
-  bool is_threaded() { return false; }
+  bool is_threaded() { return true; }
 
   virtual void on_run();
 
-protected:
-  virtual void bind_params(CassStatement* statement) const = 0;
-  virtual void verify_result(const CassResult* result) const = 0;
-
 private:
-  void run_query();
+  // Each submitting thread owns a shard with its own request budget and
+  // in-flight window. Requests are handed out by a ticket counter and the
+  // shard is finished when its completion latch drains to zero, so
+  // completions never serialize on a lock.
+  struct Shard;
+
+  // A completed request's slot is reused for the request that replaces it
+  struct Slot {
+    Shard* shard;
+    Request request;
+  };
+
+  struct Shard {
+    Shard(CallbackBenchmark* benchmark, int request_count, int window_size)
+      : benchmark(benchmark)
+      , request_count(request_count)
+      , next_ticket(0)
+      , remaining_count(window_size)
+      , slots(window_size) {
+      for (auto& slot : slots) {
+        slot.shard = this;
+      }
+    }
+
+    // Runs bounded by --duration have an effectively unbounded budget and
+    // stop handing out tickets once the benchmark stops running
+    bool take_ticket() {
+      return benchmark->is_running() && next_ticket.fetch_add(1) < request_count;
+    }
+
+    CallbackBenchmark* const benchmark;
+    const int64_t request_count;
+    std::atomic<int64_t> next_ticket;
+    std::atomic<int> remaining_count; // The slots still in use
+    std::vector<Slot> slots;
+  };
+
+  void run_query(Slot* slot);
+  void retire(Shard* shard);
 
   static void on_result(CassFuture* future, void* data);
-  void handle_result(CassFuture* future);
+  void handle_result(Slot* slot);
 
 private:
-  const int request_count_;
-  uv_mutex_t mutex_;
-  int count_;
-  int outstanding_count_;
+  std::vector<std::unique_ptr<Shard> > shards_;
+  std::atomic<size_t> next_shard_;
 };
 
 class SelectCallbackBenchmark : public CallbackBenchmark {
 public:
   SelectCallbackBenchmark(CassSession* session, const Config& config);
 
-  virtual void on_setup();
+  virtual int64_t on_prime();
 
   virtual void bind_params(CassStatement* statement) const;
   virtual void verify_result(const CassResult* result) const;
 
 private:
-  std::vector<Uuid> partition_keys_;
-  mutable std::atomic<size_t> index_;
+  const KeySpace key_space_;
+  std::unique_ptr<KeyDistribution> key_distribution_;
 };
 
 class InsertCallbackBenchmark : public CallbackBenchmark {
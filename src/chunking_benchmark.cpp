@@ -1,67 +1,135 @@
 #include "chunking_benchmark.hpp"
 
+#include "concurrency_limit.hpp"
+#include "random.hpp"
 #include "schema.hpp"
 
+#include <sstream>
+
+#define INITIAL_ADAPTIVE_LIMIT 16
+
 ChunkingBenchmark::ChunkingBenchmark(CassSession* session, const Config& config,
                                      const std::string& query, size_t parameter_count)
   : Benchmark(session, config, query, parameter_count, true) { }
 
 void ChunkingBenchmark::on_run() {
-  std::vector<CassFuture*> futures;
+  if (config().use_sliding_window || config().use_adaptive_concurrency) {
+    run_sliding_window();
+  } else {
+    run_chunks();
+  }
+
+  notify_done();
+}
+
+void ChunkingBenchmark::run_chunks() {
+  std::vector<Request> requests;
 
   int request_count = num_requests();
 
-  while(request_count > 0) {
+  while(request_count > 0 && is_running()) {
     int chunk_size = std::min(request_count, config().num_concurrent_requests);
 
-    futures.clear();
-    futures.reserve(chunk_size);
+    requests.resize(chunk_size);
 
-    for (int i = 0; i < chunk_size; ++i) {
-      CassStatement* statement;
-      if (prepared() != NULL) {
-        statement = cass_prepared_bind(prepared());
-      } else {
-        statement = cass_statement_new(query().c_str(), parameter_count());
+    for (auto& request : requests) {
+      start(&request, uv_hrtime());
+    }
+
+    // finish() takes the completion time before checking the result so each
+    // request has to be done first, otherwise its latency would end when the
+    // previous request in the chunk completed
+    for (auto& request : requests) {
+      if (request.future) {
+        cass_future_wait(request.future);
       }
-      cass_statement_set_is_idempotent(statement, cass_true);
-      bind_params(statement);
-      futures.push_back(cass_session_execute(session(), statement));
-      cass_statement_free(statement);
+      finish(&request);
     }
 
+    request_count -= chunk_size;
+  }
+}
+
+void ChunkingBenchmark::run_sliding_window() {
+  int request_count = num_requests();
+  int window_size = std::min(request_count, config().num_concurrent_requests);
+
+  // Every slot is refilled as soon as its own request completes so the
+  // number of requests in flight stays at the limit until the very end. An
+  // adaptive limit starts small and is capped by --num-concurrent-requests.
+  bool is_adaptive = config().use_adaptive_concurrency;
+  ConcurrencyLimit limit(is_adaptive ? INITIAL_ADAPTIVE_LIMIT : window_size, window_size);
+  int reported_limit = limit.limit();
+  add_concurrency_limit(reported_limit);
+
+  CompletionQueue<Slot*> queue;
+  std::vector<Slot> slots(window_size);
+  std::vector<Slot*> idle_slots;
+  for (auto& slot : slots) {
+    slot.queue = &queue;
+    idle_slots.push_back(&slot);
+  }
+
+  int outstanding_count = 0;
+  std::vector<Slot*> completed;
+  while (true) {
+    while (outstanding_count < limit.limit() && !idle_slots.empty() &&
+           request_count > 0 && is_running()) {
+      submit(idle_slots.back());
+      idle_slots.pop_back();
+      request_count--;
+      outstanding_count++;
+    }
 
-    for (auto future : futures) {
-      CassError rc = cass_future_error_code(future);
-      if (rc != CASS_OK) {
-        print_error(future);
-      } else {
-        const CassResult* result = cass_future_get_result(future);
-        verify_result(result);
-        cass_result_free(result);
+    if (outstanding_count == 0) {
+      break;
+    }
+
+    queue.wait(completed);
+    for (auto slot : completed) {
+      uint64_t latency = uv_hrtime() - slot->request.start_time;
+      finish(&slot->request);
+      if (is_adaptive) {
+        limit.update(latency);
       }
-      cass_future_free(future);
+      idle_slots.push_back(slot);
+      outstanding_count--;
     }
+    completed.clear();
 
-    request_count -= chunk_size;
+    if (limit.limit() != reported_limit) {
+      add_concurrency_limit(limit.limit() - reported_limit);
+      reported_limit = limit.limit();
+    }
   }
 
-  notify_done();
+  add_concurrency_limit(-reported_limit);
+}
+
+void ChunkingBenchmark::submit(Slot* slot) {
+  start(&slot->request, uv_hrtime());
+  set_callback(&slot->request, on_slot_ready, slot);
+}
+
+void ChunkingBenchmark::on_slot_ready(CassFuture* future, void* data) {
+  Slot* slot = static_cast<Slot*>(data);
+  slot->queue->push(slot);
 }
 
 SelectChunkingBenchmark::SelectChunkingBenchmark(CassSession* session, const Config& config)
   : ChunkingBenchmark(session, config, SELECT_QUERY, 1)
-  , index_(0) { }
+  , key_space_(config.key_seed)
+  , key_distribution_(KeyDistribution::create(config)) { }
 
-void SelectChunkingBenchmark::on_setup() {
-  partition_keys_.reserve(config().num_partition_keys);
-  for (int i = 0; i < config().num_partition_keys; ++i) {
-    partition_keys_.push_back(prime_select_query_data(session(), data()));
-  }
+int64_t SelectChunkingBenchmark::on_prime() {
+  prime_select_query_data(session(), key_space_, config().num_partition_keys, data(),
+                          config().num_threads, config().num_concurrent_requests);
+  return config().num_partition_keys;
 }
 
 void SelectChunkingBenchmark::bind_params(CassStatement* statement) const {
-  cass_statement_bind_uuid(statement, 0, partition_keys_[index_++ % partition_keys_.size()]);
+  uint64_t index = key_distribution_->next(config().num_partition_keys);
+  cass_statement_bind_uuid(statement, 0, key_space_.key(index));
 }
 
 void SelectChunkingBenchmark::verify_result(const CassResult* result) const {
@@ -81,3 +149,137 @@ void InsertChunkingBenchmark::bind_params(CassStatement* statement) const {
 void InsertChunkingBenchmark::verify_result(const CassResult* result) const {
   // No result
 }
+
+BatchChunkingBenchmark::BatchChunkingBenchmark(CassSession* session, const Config& config,
+                                               CassBatchType batch_type)
+  : ChunkingBenchmark(session, config,
+                      batch_type == CASS_BATCH_TYPE_COUNTER ? COUNTER_UPDATE_QUERY : BATCH_INSERT_QUERY,
+                      batch_type == CASS_BATCH_TYPE_COUNTER ? 2 : 3)
+  , batch_type_(batch_type) { }
+
+CassFuture* BatchChunkingBenchmark::execute(Request* request) const {
+  CassBatch* batch = cass_batch_new(batch_type_);
+
+  // Counter updates are never safe to retry
+  if (batch_type_ != CASS_BATCH_TYPE_COUNTER) {
+    cass_batch_set_is_idempotent(batch, cass_true);
+  }
+
+  // Same partition batches write "batch_size" rows into a single partition,
+  // cross partition batches write each row into its own partition
+  bool is_cross_partition = config().batch_grouping == "cross";
+  Uuid key = generate_random_uuid();
+  for (int i = 0; i < config().batch_size; ++i) {
+    CassStatement* statement = new_statement();
+    if (is_cross_partition && i > 0) {
+      key = generate_random_uuid();
+    }
+    bind_entry(statement, key, i);
+    cass_batch_add_statement(batch, statement);
+    cass_statement_free(statement);
+  }
+
+  return execute_batch(batch);
+}
+
+void BatchChunkingBenchmark::bind_params(CassStatement* statement) const {
+  // Batch entries are bound in execute()
+}
+
+void BatchChunkingBenchmark::verify_result(const CassResult* result) const {
+  // No result
+}
+
+void BatchChunkingBenchmark::bind_entry(CassStatement* statement, const Uuid& key, int id) const {
+  cass_statement_bind_uuid(statement, 0, key);
+  cass_statement_bind_int32(statement, 1, id);
+  if (batch_type_ != CASS_BATCH_TYPE_COUNTER) {
+    cass_statement_bind_string_n(statement, 2, data().c_str(), data().size());
+  }
+}
+
+static ChunkingBenchmark* create_mixed_operation(const std::string& type,
+                                                 CassSession* session, const Config& config) {
+  if (type == "select") {
+    return new SelectChunkingBenchmark(session, config);
+  } else if (type == "insert") {
+    return new InsertChunkingBenchmark(session, config);
+  } else if (type == "insertbatch") {
+    return new BatchChunkingBenchmark(session, config, CASS_BATCH_TYPE_LOGGED);
+  } else if (type == "unloggedbatch") {
+    return new BatchChunkingBenchmark(session, config, CASS_BATCH_TYPE_UNLOGGED);
+  } else if (type == "counterbatch") {
+    return new BatchChunkingBenchmark(session, config, CASS_BATCH_TYPE_COUNTER);
+  }
+  return NULL;
+}
+
+MixedChunkingBenchmark::MixedChunkingBenchmark(CassSession* session, const Config& config)
+  : ChunkingBenchmark(session, config, "", 0) {
+  std::stringstream mix(config.mix);
+  std::string item;
+  int total_weight = 0;
+  while (std::getline(mix, item, ',')) {
+    size_t pos = item.find('=');
+    std::string type(item.substr(0, pos));
+    int weight = pos != std::string::npos ? atoi(item.substr(pos + 1).c_str()) : 0;
+    if (weight <= 0) {
+      fprintf(stderr, "--mix has an invalid weight for '%s'\n", type.c_str());
+      exit(-1);
+    }
+
+    ChunkingBenchmark* benchmark = create_mixed_operation(type, session, config);
+    if (benchmark == NULL) {
+      fprintf(stderr, "--mix has the invalid type '%s'\n", type.c_str());
+      exit(-1);
+    }
+
+    benchmarks_.push_back(std::unique_ptr<ChunkingBenchmark>(benchmark));
+    add_operation(type);
+    total_weight += weight;
+    cumulative_weights_.push_back(total_weight);
+  }
+
+  if (benchmarks_.empty()) {
+    fprintf(stderr, "--mix requires at least one type\n");
+    exit(-1);
+  }
+}
+
+void MixedChunkingBenchmark::on_setup() {
+  for (auto& benchmark : benchmarks_) {
+    benchmark->set_prepared_cache(prepared_cache());
+    benchmark->setup();
+  }
+}
+
+int64_t MixedChunkingBenchmark::on_prime() {
+  int64_t num_primed_keys = 0;
+  for (auto& benchmark : benchmarks_) {
+    benchmark->prime();
+    num_primed_keys += benchmark->num_primed_keys();
+  }
+  return num_primed_keys;
+}
+
+CassFuture* MixedChunkingBenchmark::execute(Request* request) const {
+  int value = static_cast<int>(Random::local().next(cumulative_weights_.back()));
+  size_t operation = 0;
+  while (value >= cumulative_weights_[operation]) {
+    operation++;
+  }
+  request->operation = operation;
+  return benchmarks_[operation]->execute(request);
+}
+
+CassError MixedChunkingBenchmark::check_result(const Request& request) const {
+  return benchmarks_[request.operation]->check_result(request);
+}
+
+void MixedChunkingBenchmark::bind_params(CassStatement* statement) const {
+  // Statements are bound by the workload picked for each request
+}
+
+void MixedChunkingBenchmark::verify_result(const CassResult* result) const {
+  // Results are verified by the workload picked for each request
+}
@@ -2,9 +2,13 @@
 #define CHUNKING_BENCHMARK_HPP
 
 #include "benchmark.hpp"
+#include "completion_queue.hpp"
+#include "key_distribution.hpp"
+#include "key_space.hpp"
 #include "utils.hpp"
 
 #include <atomic>
+#include <memory>
 #include <vector>
 
 class ChunkingBenchmark : public Benchmark {
@@ -16,23 +20,32 @@ public:
 
   virtual void on_run();
 
-protected:
-  virtual void bind_params(CassStatement* statement) const = 0;
-  virtual void verify_result(const CassResult* result) const = 0;
+private:
+  // A slot in a thread's fixed pool of in-flight requests
+  struct Slot {
+    CompletionQueue<Slot*>* queue;
+    Request request;
+  };
+
+  void run_chunks();
+  void run_sliding_window();
+  void submit(Slot* slot);
+
+  static void on_slot_ready(CassFuture* future, void* data);
 };
 
 class SelectChunkingBenchmark : public ChunkingBenchmark {
 public:
   SelectChunkingBenchmark(CassSession* session, const Config& config);
 
-  virtual void on_setup();
+  virtual int64_t on_prime();
 
   virtual void bind_params(CassStatement* statement) const;
   virtual void verify_result(const CassResult* result) const;
 
 private:
-  std::vector<Uuid> partition_keys_;
-  mutable std::atomic<size_t> index_;
+  const KeySpace key_space_;
+  std::unique_ptr<KeyDistribution> key_distribution_;
 };
 
 class InsertChunkingBenchmark : public ChunkingBenchmark {
@@ -43,4 +56,44 @@ public:
   virtual void verify_result(const CassResult* result) const;
 };
 
+class BatchChunkingBenchmark : public ChunkingBenchmark {
+public:
+  BatchChunkingBenchmark(CassSession* session, const Config& config,
+                         CassBatchType batch_type);
+
+  virtual int statements_per_request() const { return config().batch_size; }
+
+  virtual CassFuture* execute(Request* request) const;
+
+  virtual void bind_params(CassStatement* statement) const;
+  virtual void verify_result(const CassResult* result) const;
+
+private:
+  void bind_entry(CassStatement* statement, const Uuid& key, int id) const;
+
+private:
+  const CassBatchType batch_type_;
+};
+
+// Sends a weighted mix of the other chunking workloads (e.g. "--mix
+// select=80,insert=20"). Each request is bound and verified by the workload
+// it was picked from and results are reported per workload.
+class MixedChunkingBenchmark : public ChunkingBenchmark {
+public:
+  MixedChunkingBenchmark(CassSession* session, const Config& config);
+
+  virtual void on_setup();
+  virtual int64_t on_prime();
+
+  virtual CassFuture* execute(Request* request) const;
+  virtual CassError check_result(const Request& request) const;
+
+  virtual void bind_params(CassStatement* statement) const;
+  virtual void verify_result(const CassResult* result) const;
+
+private:
+  std::vector<std::unique_ptr<ChunkingBenchmark> > benchmarks_;
+  std::vector<int> cumulative_weights_;
+};
+
 #endif // CHUNKING_BENCHMARK_HPP
@@ -0,0 +1,237 @@
+#include "compare.hpp"
+
+#include "random.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#define BOOTSTRAP_ITERATIONS 2000
+#define BOOTSTRAP_SEED 42
+
+enum Metric {
+  RATE,
+  MEDIAN,
+  P99,
+  P999,
+  NUM_METRICS
+};
+
+// The time series column each metric is read from
+static const char* METRIC_COLUMNS[NUM_METRICS] = {
+  "interval rate", "interval med", "interval 99th", "interval 99.9"
+};
+static const char* METRIC_NAMES[NUM_METRICS] = { "rate", "median", "99th", "99.9th" };
+static const bool IS_HIGHER_BETTER[NUM_METRICS] = { true, false, false, false };
+
+struct Sample {
+  double values[NUM_METRICS];
+};
+
+typedef std::vector<Sample> Run;
+
+struct ResultSet {
+  std::string name;
+  std::vector<Run> runs;
+};
+
+static std::vector<std::string> split(const std::string& line, char delimiter) {
+  std::vector<std::string> fields;
+  std::stringstream stream(line);
+  std::string field;
+  while (std::getline(stream, field, delimiter)) {
+    size_t first = field.find_first_not_of(" \t\r");
+    size_t last = field.find_last_not_of(" \t\r");
+    fields.push_back(first == std::string::npos ? "" : field.substr(first, last - first + 1));
+  }
+  return fields;
+}
+
+// Reads the sample rows of the time series in a result file, skipping the
+// samples that weren't entirely in the steady-state window. Files with several
+// series (one per load level, scenario or trial) are rejected so samples from
+// different workloads are never pooled into one run
+static Run load_run(const std::string& filename) {
+  std::ifstream file(filename.c_str());
+  if (!file) {
+    fprintf(stderr, "Unable to open result file: %s\n", filename.c_str());
+    exit(-1);
+  }
+
+  Run run;
+  std::string line;
+  bool is_in_series = false;
+  int num_series = 0;
+  int steady_column = -1;
+  int columns[NUM_METRICS];
+  while (std::getline(file, line)) {
+    std::vector<std::string> fields(split(line, ','));
+    if (std::find(fields.begin(), fields.end(), "interval count") != fields.end()) {
+      if (++num_series > 1) {
+        fprintf(stderr, "Result file '%s' has more than one time series (e.g. from --ramp, "
+                        "--slo-p99, --scenario-file or --repeat), compare files from single runs\n",
+                filename.c_str());
+        exit(-1);
+      }
+      is_in_series = true;
+      auto steady = std::find(fields.begin(), fields.end(), "steady");
+      if (steady == fields.end()) {
+        fprintf(stderr, "Result file '%s' has no 'steady' column\n", filename.c_str());
+        exit(-1);
+      }
+      steady_column = static_cast<int>(steady - fields.begin());
+      for (int i = 0; i < NUM_METRICS; ++i) {
+        auto it = std::find(fields.begin(), fields.end(), METRIC_COLUMNS[i]);
+        if (it == fields.end()) {
+          fprintf(stderr, "Result file '%s' has no '%s' column\n", filename.c_str(), METRIC_COLUMNS[i]);
+          exit(-1);
+        }
+        columns[i] = static_cast<int>(it - fields.begin());
+      }
+    } else if (fields.empty() || fields[0].empty()) {
+      is_in_series = false;
+    } else if (is_in_series && static_cast<int>(fields.size()) > steady_column) {
+      if (atoi(fields[steady_column].c_str()) == 0) {
+        continue;
+      }
+      Sample sample;
+      for (int i = 0; i < NUM_METRICS; ++i) {
+        sample.values[i] = static_cast<int>(fields.size()) > columns[i] ? atof(fields[columns[i]].c_str()) : 0.0;
+      }
+      run.push_back(sample);
+    }
+  }
+
+  if (run.empty()) {
+    fprintf(stderr, "Result file '%s' has no samples\n", filename.c_str());
+    exit(-1);
+  }
+  return run;
+}
+
+static ResultSet load_result_set(const std::string& arg) {
+  ResultSet set;
+  set.name = arg;
+  std::vector<std::string> filenames(split(arg, ','));
+  for (const auto& filename : filenames) {
+    set.runs.push_back(load_run(filename));
+  }
+  return set;
+}
+
+// Every run weighs the same however many samples it has
+static double mean(const ResultSet& set, int metric) {
+  double sum = 0.0;
+  for (const auto& run : set.runs) {
+    double run_sum = 0.0;
+    for (const auto& sample : run) {
+      run_sum += sample.values[metric];
+    }
+    sum += run_sum / run.size();
+  }
+  return sum / set.runs.size();
+}
+
+// Consecutive samples of a run are correlated so they're resampled in blocks
+// (a moving block bootstrap with blocks of about the cube root of the run's
+// samples) rather than one by one
+static double resampled_mean(const ResultSet& set, int metric, Random& random) {
+  double sum = 0.0;
+  for (size_t i = 0; i < set.runs.size(); ++i) {
+    const Run& run = set.runs[random.next(set.runs.size())];
+    size_t block_size = static_cast<size_t>(std::ceil(std::cbrt(static_cast<double>(run.size()))));
+    double run_sum = 0.0;
+    size_t count = 0;
+    while (count < run.size()) {
+      size_t start = random.next(run.size() - block_size + 1);
+      for (size_t j = start; j < start + block_size && count < run.size(); ++j, ++count) {
+        run_sum += run[j].values[metric];
+      }
+    }
+    sum += run_sum / run.size();
+  }
+  return sum / set.runs.size();
+}
+
+static double percentile(const std::vector<double>& sorted, double percentile) {
+  size_t index = static_cast<size_t>(percentile / 100.0 * (sorted.size() - 1) + 0.5);
+  return sorted[std::min(index, sorted.size() - 1)];
+}
+
+int run_compare(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "compare expects a baseline and at least one candidate "
+                    "(each a result file or a comma separated list of repeated runs)\n");
+    return -1;
+  }
+
+  ResultSet baseline(load_result_set(argv[0]));
+  std::vector<ResultSet> candidates;
+  for (int i = 1; i < argc; ++i) {
+    candidates.push_back(load_result_set(argv[i]));
+  }
+
+  Random random(BOOTSTRAP_SEED);
+  bool has_regression = false;
+
+  // Deltas are relative to the baseline, latencies are in microseconds
+  fprintf(stdout,
+          "\ncompare, baseline %s (%u runs)\n"
+          "%40s, %8s, %12s, %12s, %9s, %9s, %9s, %17s\n",
+          baseline.name.c_str(), static_cast<unsigned int>(baseline.runs.size()),
+          "candidate", "metric", "baseline", "candidate",
+          "delta %", "lower %", "upper %", "result");
+  for (const auto& candidate : candidates) {
+    for (int metric = 0; metric < NUM_METRICS; ++metric) {
+      double baseline_mean = mean(baseline, metric);
+      double candidate_mean = mean(candidate, metric);
+      if (baseline_mean == 0.0) {
+        continue;
+      }
+
+      // A single run says nothing about the run to run variance, which is
+      // often larger than the differences being looked for
+      double delta = 100.0 * (candidate_mean - baseline_mean) / baseline_mean;
+      if (baseline.runs.size() < 2 || candidate.runs.size() < 2) {
+        fprintf(stdout,
+                "%40s, %8s, %12g, %12g, %9.2f, %9s, %9s, %17s\n",
+                candidate.name.c_str(), METRIC_NAMES[metric], baseline_mean, candidate_mean,
+                delta, "", "", "insufficient runs");
+        continue;
+      }
+
+      std::vector<double> deltas;
+      for (int i = 0; i < BOOTSTRAP_ITERATIONS; ++i) {
+        double baseline_resampled = resampled_mean(baseline, metric, random);
+        double candidate_resampled = resampled_mean(candidate, metric, random);
+        if (baseline_resampled != 0.0) {
+          deltas.push_back(100.0 * (candidate_resampled - baseline_resampled) / baseline_resampled);
+        }
+      }
+      std::sort(deltas.begin(), deltas.end());
+
+      double lower = deltas.empty() ? delta : percentile(deltas, 2.5);
+      double upper = deltas.empty() ? delta : percentile(deltas, 97.5);
+
+      // Only an interval that excludes zero is significant
+      const char* result = "no change";
+      if (lower > 0.0 || upper < 0.0) {
+        bool is_better = (lower > 0.0) == IS_HIGHER_BETTER[metric];
+        result = is_better ? "improvement" : "REGRESSION";
+        has_regression = has_regression || !is_better;
+      }
+
+      fprintf(stdout,
+              "%40s, %8s, %12g, %12g, %9.2f, %9.2f, %9.2f, %17s\n",
+              candidate.name.c_str(), METRIC_NAMES[metric], baseline_mean, candidate_mean,
+              delta, lower, upper, result);
+    }
+  }
+
+  return has_regression ? 1 : 0;
+}
@@ -0,0 +1,15 @@
+#ifndef COMPARE_HPP
+#define COMPARE_HPP
+
+// The "compare" subcommand: compare <baseline> <candidate> [<candidate> ...]
+//
+// Each result set is a result file or a comma separated list of files from
+// repeated runs, each file holding a single time series. Sets are compared
+// on the steady-state samples of their time series using a two level
+// bootstrap (runs, then blocks of consecutive samples within each run) for
+// 95% confidence intervals of the deltas. Sets need at least two runs each
+// to be judged. Returns 1 if a candidate is significantly worse than the
+// baseline, 0 otherwise.
+int run_compare(int argc, char** argv);
+
+#endif // COMPARE_HPP
@@ -0,0 +1,50 @@
+#ifndef COMPLETION_QUEUE_HPP
+#define COMPLETION_QUEUE_HPP
+
+#include <uv.h>
+
+#include <vector>
+
+// Collects items completed on the driver's IO threads for a single consumer.
+// The consumer takes everything that has completed in one batch, so it only
+// touches the lock once per wake up rather than once per item.
+template <class T>
+class CompletionQueue {
+public:
+  CompletionQueue() {
+    uv_mutex_init(&mutex_);
+    uv_cond_init(&cond_);
+  }
+
+  ~CompletionQueue() {
+    uv_mutex_destroy(&mutex_);
+    uv_cond_destroy(&cond_);
+  }
+
+  void push(T item) {
+    uv_mutex_lock(&mutex_);
+    items_.push_back(item);
+    if (items_.size() == 1) {
+      uv_cond_signal(&cond_);
+    }
+    uv_mutex_unlock(&mutex_);
+  }
+
+  // Waits until at least one item has completed and swaps all completed
+  // items into "items" (which is expected to be empty)
+  void wait(std::vector<T>& items) {
+    uv_mutex_lock(&mutex_);
+    while (items_.empty()) {
+      uv_cond_wait(&cond_, &mutex_);
+    }
+    items_.swap(items);
+    uv_mutex_unlock(&mutex_);
+  }
+
+private:
+  uv_mutex_t mutex_;
+  uv_cond_t cond_;
+  std::vector<T> items_;
+};
+
+#endif // COMPLETION_QUEUE_HPP
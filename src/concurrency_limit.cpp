@@ -0,0 +1,45 @@
+#include "concurrency_limit.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#define MIN_LIMIT 1
+// How far above the no-load latency a window can be before the limit shrinks
+#define LATENCY_TOLERANCE 2.0
+// How much of each new limit is blended into the current one
+#define SMOOTHING 0.2
+// The gradient is clamped so a single slow window at most halves the limit
+#define MIN_GRADIENT 0.5
+
+ConcurrencyLimit::ConcurrencyLimit(int initial_limit, int max_limit)
+  : max_limit_(std::max(max_limit, MIN_LIMIT))
+  , limit_(std::min(std::max(initial_limit, MIN_LIMIT), max_limit_))
+  , min_latency_ns_(0.0)
+  , window_latency_sum_ns_(0.0)
+  , window_count_(0) { }
+
+void ConcurrencyLimit::update(uint64_t latency_ns) {
+  window_latency_sum_ns_ += latency_ns;
+  window_count_++;
+
+  // A window is roughly one round trip's worth of requests
+  if (window_count_ < limit()) {
+    return;
+  }
+
+  double window_latency_ns = window_latency_sum_ns_ / window_count_;
+  window_latency_sum_ns_ = 0.0;
+  window_count_ = 0;
+
+  // Any drift of the no-load latency while requests are queued would let
+  // the queue (and the limit) creep up with it, so it only ever decreases
+  if (min_latency_ns_ == 0.0 || window_latency_ns < min_latency_ns_) {
+    min_latency_ns_ = window_latency_ns;
+  }
+
+  double gradient = window_latency_ns > 0.0 ? LATENCY_TOLERANCE * min_latency_ns_ / window_latency_ns : 1.0;
+  gradient = std::max(MIN_GRADIENT, std::min(1.0, gradient));
+  double new_limit = limit_ * gradient + std::sqrt(limit_);
+  limit_ = (1.0 - SMOOTHING) * limit_ + SMOOTHING * new_limit;
+  limit_ = std::max(static_cast<double>(MIN_LIMIT), std::min(limit_, static_cast<double>(max_limit_)));
+}
@@ -0,0 +1,31 @@
+#ifndef CONCURRENCY_LIMIT_HPP
+#define CONCURRENCY_LIMIT_HPP
+
+#include <stdint.h>
+
+// An adaptive limit on the number of in-flight requests driven by the
+// latency gradient: the ratio of the no-load latency (the lowest seen, with
+// some tolerance) to the latency of the most recent window of
+// requests. While latency stays within the tolerance the limit grows by
+// about sqrt(limit) per window. Once requests start queueing, latency rises
+// and the limit shrinks in proportion. This is in the spirit of Little's
+// law: beyond the cluster's throughput, more requests only add queueing.
+// Not thread-safe, each submitting thread owns its own limit.
+class ConcurrencyLimit {
+public:
+  ConcurrencyLimit(int initial_limit, int max_limit);
+
+  int limit() const { return static_cast<int>(limit_); }
+
+  // Feeds the latency of a completed request
+  void update(uint64_t latency_ns);
+
+private:
+  const int max_limit_;
+  double limit_;
+  double min_latency_ns_;
+  double window_latency_sum_ns_;
+  int window_count_;
+};
+
+#endif // CONCURRENCY_LIMIT_HPP
@@ -17,6 +17,36 @@ if (i + 1 >= argc) { \
 } \
 } while (0)
 
+// Parses a comma separated list of positive integers
+static void parse_int_list(const char* name, const char* arg, std::vector<int>* values) {
+  std::stringstream list(arg);
+  std::string item;
+  values->clear();
+  while (std::getline(list, item, ',')) {
+    int value = atoi(item.c_str());
+    if (value <= 0) {
+      fprintf(stderr, "%s has the invalid value '%s'\n", name, arg);
+      exit(-1);
+    }
+    values->push_back(value);
+  }
+  if (values->empty()) {
+    fprintf(stderr, "%s expects a comma separated list of values\n", name);
+    exit(-1);
+  }
+}
+
+static std::string format_int_list(const std::vector<int>& values) {
+  std::stringstream list;
+  for (size_t i = 0; i < values.size(); ++i) {
+    if (i > 0) {
+      list << ",";
+    }
+    list << values[i];
+  }
+  return list.str();
+}
+
 void Config::from_cli(int argc, char** argv) {
   for (int i = 1; i < argc; ++i) {
     if (i > 1) {
@@ -38,10 +68,31 @@ void Config::from_cli(int argc, char** argv) {
       type = argv[i + 1];
       std::transform(type.begin(), type.end(), type.begin(), ::tolower);
       i++;
+    } else if (strcmp(arg, "--mix") == 0) {
+      CHECK_ARG("--mix");
+      mix = argv[i + 1];
+      std::transform(mix.begin(), mix.end(), mix.begin(), ::tolower);
+      i++;
     } else if (strcmp(arg, "--label") == 0) {
       CHECK_ARG("--label");
       label = argv[i + 1];
       i++;
+    } else if (strcmp(arg, "--scenario-file") == 0) {
+      CHECK_ARG("--scenario-file");
+      scenario_file = argv[i + 1];
+      i++;
+    } else if (strcmp(arg, "--reuse-dataset") == 0) {
+      CHECK_ARG("--reuse-dataset");
+      reuse_dataset = argv[i + 1];
+      i++;
+    } else if (strcmp(arg, "--port") == 0) {
+      CHECK_ARG("--port");
+      port = atoi(argv[i + 1]);
+      if (port <= 0 || port > 65535) {
+        fprintf(stderr, "--port has the invalid value %d\n", port);
+        exit(-1);
+      }
+      i++;
     } else if (strcmp(arg, "--num-threads") == 0) {
       CHECK_ARG("--num-threads");
       num_threads = atoi(argv[i + 1]);
@@ -84,9 +135,49 @@ void Config::from_cli(int argc, char** argv) {
       i++;
     } else if (strcmp(arg, "--num-partition-keys") == 0) {
       CHECK_ARG("--num-partition-keys");
-      num_partition_keys = atoi(argv[i + 1]);
+      num_partition_keys = strtoll(argv[i + 1], NULL, 10);
       if (num_partition_keys <= 0) {
-        fprintf(stderr, "--num-partition-keys has the invalid value %d\n", num_partition_keys);
+        fprintf(stderr, "--num-partition-keys has the invalid value %lld\n",
+                static_cast<long long>(num_partition_keys));
+        exit(-1);
+      }
+      i++;
+    } else if (strcmp(arg, "--key-seed") == 0) {
+      CHECK_ARG("--key-seed");
+      key_seed = strtoull(argv[i + 1], NULL, 10);
+      i++;
+    } else if (strcmp(arg, "--key-distribution") == 0) {
+      CHECK_ARG("--key-distribution");
+      key_distribution = argv[i + 1];
+      std::transform(key_distribution.begin(), key_distribution.end(), key_distribution.begin(), ::tolower);
+      if (key_distribution != "uniform" && key_distribution != "zipfian" &&
+          key_distribution != "hotspot" && key_distribution != "sequential" &&
+          key_distribution != "latest") {
+        fprintf(stderr, "--key-distribution has the invalid value %s\n", key_distribution.c_str());
+        exit(-1);
+      }
+      i++;
+    } else if (strcmp(arg, "--zipfian-exponent") == 0) {
+      CHECK_ARG("--zipfian-exponent");
+      zipfian_exponent = atof(argv[i + 1]);
+      if (zipfian_exponent <= 0.0) {
+        fprintf(stderr, "--zipfian-exponent has the invalid value %g\n", zipfian_exponent);
+        exit(-1);
+      }
+      i++;
+    } else if (strcmp(arg, "--hotspot-keys") == 0) {
+      CHECK_ARG("--hotspot-keys");
+      hotspot_keys = atoi(argv[i + 1]);
+      if (hotspot_keys <= 0 || hotspot_keys > 100) {
+        fprintf(stderr, "--hotspot-keys has the invalid value %d\n", hotspot_keys);
+        exit(-1);
+      }
+      i++;
+    } else if (strcmp(arg, "--hotspot-ops") == 0) {
+      CHECK_ARG("--hotspot-ops");
+      hotspot_ops = atoi(argv[i + 1]);
+      if (hotspot_ops < 0 || hotspot_ops > 100) {
+        fprintf(stderr, "--hotspot-ops has the invalid value %d\n", hotspot_ops);
         exit(-1);
       }
       i++;
@@ -98,6 +189,15 @@ void Config::from_cli(int argc, char** argv) {
         exit(-1);
       }
       i++;
+    } else if (strcmp(arg, "--batch-grouping") == 0) {
+      CHECK_ARG("--batch-grouping");
+      batch_grouping = argv[i + 1];
+      std::transform(batch_grouping.begin(), batch_grouping.end(), batch_grouping.begin(), ::tolower);
+      if (batch_grouping != "same" && batch_grouping != "cross") {
+        fprintf(stderr, "--batch-grouping has the invalid value %s\n", batch_grouping.c_str());
+        exit(-1);
+      }
+      i++;
     } else if (strcmp(arg, "--data-size") == 0) {
       CHECK_ARG("--data-size");
       data_size = atoi(argv[i + 1]);
@@ -131,6 +231,67 @@ void Config::from_cli(int argc, char** argv) {
         exit(-1);
       }
       i++;
+    } else if (strcmp(arg, "--target-rate") == 0) {
+      CHECK_ARG("--target-rate");
+      target_rate = atoi(argv[i + 1]);
+      if (target_rate < 0) {
+        fprintf(stderr, "--target-rate has the invalid value %d\n", target_rate);
+        exit(-1);
+      }
+      i++;
+    } else if (strcmp(arg, "--duration") == 0) {
+      CHECK_ARG("--duration");
+      duration = atoi(argv[i + 1]);
+      if (duration < 0) {
+        fprintf(stderr, "--duration has the invalid value %d\n", duration);
+        exit(-1);
+      }
+      i++;
+    } else if (strcmp(arg, "--warmup") == 0) {
+      CHECK_ARG("--warmup");
+      warmup = atoi(argv[i + 1]);
+      if (warmup < 0) {
+        fprintf(stderr, "--warmup has the invalid value %d\n", warmup);
+        exit(-1);
+      }
+      i++;
+    } else if (strcmp(arg, "--cooldown") == 0) {
+      CHECK_ARG("--cooldown");
+      cooldown = atoi(argv[i + 1]);
+      if (cooldown < 0) {
+        fprintf(stderr, "--cooldown has the invalid value %d\n", cooldown);
+        exit(-1);
+      }
+      i++;
+    } else if (strcmp(arg, "--ramp") == 0) {
+      CHECK_ARG("--ramp");
+      char ramp[32];
+      if (sscanf(argv[i + 1], "%31[^:]:%d:%d:%d", ramp, &ramp_start, &ramp_stop, &ramp_step) != 4 ||
+          (strcmp(ramp, "concurrency") != 0 && strcmp(ramp, "rate") != 0) ||
+          ramp_start <= 0 || ramp_stop < ramp_start || ramp_step <= 0) {
+        fprintf(stderr, "--ramp has the invalid value '%s' (expected <concurrency|rate>:<start>:<stop>:<step>)\n",
+                argv[i + 1]);
+        exit(-1);
+      }
+      ramp_type = ramp;
+      i++;
+    } else if (strcmp(arg, "--slo-p99") == 0) {
+      CHECK_ARG("--slo-p99");
+      slo_p99 = atoi(argv[i + 1]);
+      if (slo_p99 <= 0) {
+        fprintf(stderr, "--slo-p99 has the invalid value %d\n", slo_p99);
+        exit(-1);
+      }
+      i++;
+    } else if (strcmp(arg, "--slo-control") == 0) {
+      CHECK_ARG("--slo-control");
+      slo_control = argv[i + 1];
+      if (slo_control != "rate" && slo_control != "concurrency") {
+        fprintf(stderr, "--slo-control has the invalid value '%s' (expected rate or concurrency)\n",
+                slo_control.c_str());
+        exit(-1);
+      }
+      i++;
     } else if (strcmp(arg, "--use-token-aware") == 0) {
       CHECK_ARG("--use-token-aware");
       use_token_aware = atoi(argv[i + 1]);
@@ -147,6 +308,78 @@ void Config::from_cli(int argc, char** argv) {
       CHECK_ARG("--use-stdout");
       use_stdout = atoi(argv[i + 1]) != 0;
       i++;
+    } else if (strcmp(arg, "--use-sliding-window") == 0) {
+      CHECK_ARG("--use-sliding-window");
+      use_sliding_window = atoi(argv[i + 1]) != 0;
+      i++;
+    } else if (strcmp(arg, "--use-adaptive-concurrency") == 0) {
+      CHECK_ARG("--use-adaptive-concurrency");
+      use_adaptive_concurrency = atoi(argv[i + 1]) != 0;
+      i++;
+    } else if (strcmp(arg, "--use-mock-server") == 0) {
+      CHECK_ARG("--use-mock-server");
+      use_mock_server = atoi(argv[i + 1]) != 0;
+      i++;
+    } else if (strcmp(arg, "--use-null-driver") == 0) {
+      CHECK_ARG("--use-null-driver");
+      use_null_driver = atoi(argv[i + 1]) != 0;
+      i++;
+    } else if (strcmp(arg, "--mock-server-nodes") == 0) {
+      CHECK_ARG("--mock-server-nodes");
+      mock_server_nodes = atoi(argv[i + 1]);
+      if (mock_server_nodes <= 0 || mock_server_nodes > 254) {
+        fprintf(stderr, "--mock-server-nodes has the invalid value %d\n", mock_server_nodes);
+        exit(-1);
+      }
+      i++;
+    } else if (strcmp(arg, "--mock-latency") == 0) {
+      CHECK_ARG("--mock-latency");
+      mock_latency = argv[i + 1];
+      i++;
+    } else if (strcmp(arg, "--mock-errors") == 0) {
+      CHECK_ARG("--mock-errors");
+      mock_errors = argv[i + 1];
+      i++;
+    } else if (strcmp(arg, "--mock-disconnect-interval") == 0) {
+      CHECK_ARG("--mock-disconnect-interval");
+      mock_disconnect_interval = atoi(argv[i + 1]);
+      if (mock_disconnect_interval < 0) {
+        fprintf(stderr, "--mock-disconnect-interval has the invalid value %d\n", mock_disconnect_interval);
+        exit(-1);
+      }
+      i++;
+    } else if (strcmp(arg, "--sweep-num-io-threads") == 0) {
+      CHECK_ARG("--sweep-num-io-threads");
+      parse_int_list("--sweep-num-io-threads", argv[i + 1], &sweep_num_io_threads);
+      i++;
+    } else if (strcmp(arg, "--sweep-num-core-connections") == 0) {
+      CHECK_ARG("--sweep-num-core-connections");
+      parse_int_list("--sweep-num-core-connections", argv[i + 1], &sweep_num_core_connections);
+      i++;
+    } else if (strcmp(arg, "--sweep-num-threads") == 0) {
+      CHECK_ARG("--sweep-num-threads");
+      parse_int_list("--sweep-num-threads", argv[i + 1], &sweep_num_threads);
+      i++;
+    } else if (strcmp(arg, "--sweep-num-concurrent-requests") == 0) {
+      CHECK_ARG("--sweep-num-concurrent-requests");
+      parse_int_list("--sweep-num-concurrent-requests", argv[i + 1], &sweep_num_concurrent_requests);
+      i++;
+    } else if (strcmp(arg, "--repeat") == 0) {
+      CHECK_ARG("--repeat");
+      repeat = atoi(argv[i + 1]);
+      if (repeat <= 0) {
+        fprintf(stderr, "--repeat has the invalid value %d\n", repeat);
+        exit(-1);
+      }
+      i++;
+    } else if (strcmp(arg, "--repeat-reprime") == 0) {
+      CHECK_ARG("--repeat-reprime");
+      repeat_reprime = atoi(argv[i + 1]) != 0;
+      i++;
+    } else if (strcmp(arg, "--repeat-reconnect") == 0) {
+      CHECK_ARG("--repeat-reconnect");
+      repeat_reconnect = atoi(argv[i + 1]) != 0;
+      i++;
     } else if (strcmp(arg, "--trust-cert-file") == 0) {
       CHECK_ARG("--trust-cert-file");
       trusted_cert_file = argv[i + 1] != 0;
@@ -157,20 +390,104 @@ void Config::from_cli(int argc, char** argv) {
       exit(-1);
     }
   }
+
+  // A request bound run has no known end to cool down from
+  if (cooldown > 0 && duration == 0) {
+    fprintf(stderr, "--cooldown requires --duration\n");
+    exit(-1);
+  }
+
+  // Every step of a ramp runs for the same amount of time
+  if (!ramp_type.empty() && duration == 0) {
+    fprintf(stderr, "--ramp requires --duration\n");
+    exit(-1);
+  }
+
+  // The limit adapts the sliding window of the chunking workloads. Paced
+  // runs have their load set by the rate instead.
+  if (use_adaptive_concurrency &&
+      (type.find("callback") != std::string::npos || target_rate > 0)) {
+    fprintf(stderr, "--use-adaptive-concurrency requires a non-callback workload without --target-rate\n");
+    exit(-1);
+  }
+
+  if (slo_p99 > 0 && duration == 0) {
+    fprintf(stderr, "--slo-p99 requires --duration\n");
+    exit(-1);
+  }
+
+  if (slo_p99 > 0 && !ramp_type.empty()) {
+    fprintf(stderr, "--slo-p99 and --ramp can't be used together\n");
+    exit(-1);
+  }
+
+  if (is_sweep() && (slo_p99 > 0 || !ramp_type.empty())) {
+    fprintf(stderr, "--sweep-* can't be used with --slo-p99 or --ramp\n");
+    exit(-1);
+  }
+
+  // Trials compare single runs of the same workload
+  if (repeat > 1 && (is_sweep() || !scenario_file.empty() || slo_p99 > 0 || !ramp_type.empty())) {
+    fprintf(stderr, "--repeat can't be used with --sweep-*, --scenario-file, --slo-p99 or --ramp\n");
+    exit(-1);
+  }
+
+  // Re-priming truncates the tables, which would leave a reused dataset with
+  // fewer keys than its file records
+  if (repeat_reprime && !reuse_dataset.empty()) {
+    fprintf(stderr, "--repeat-reprime can't be used with --reuse-dataset\n");
+    exit(-1);
+  }
+
+  if (mock_server_nodes > 1 && !use_mock_server) {
+    fprintf(stderr, "--mock-server-nodes requires --use-mock-server\n");
+    exit(-1);
+  }
+
+  if ((!mock_latency.empty() || !mock_errors.empty() || mock_disconnect_interval > 0) && !use_mock_server) {
+    fprintf(stderr, "--mock-latency, --mock-errors and --mock-disconnect-interval require --use-mock-server\n");
+    exit(-1);
+  }
+
+  if (is_sweep() && !scenario_file.empty()) {
+    fprintf(stderr, "--sweep-* can't be used with --scenario-file\n");
+    exit(-1);
+  }
 }
 
-void Config::dump(FILE* file) {
+void Config::dump(FILE* file) const {
+  char ramp[64] = "";
+  if (!ramp_type.empty()) {
+    snprintf(ramp, sizeof(ramp), "%s:%d:%d:%d", ramp_type.c_str(), ramp_start, ramp_stop, ramp_step);
+  }
   fprintf(file, "\ncli-arguments\n%s\n",
           args_.empty() ? "Using defaults" : args_.c_str());
   fprintf(file, "\ncli-full-arguments\n"
-                "--hosts \"%s\" --type %s --label \"%s\" --protocol-version %d "
+                "--hosts \"%s\" --port %d --type %s --mix %s --label \"%s\" --reuse-dataset \"%s\" --scenario-file \"%s\" --protocol-version %d "
                 "--num-threads %d --num-io-threads %d --num-core-connections %d --num-requests %d --num-concurrent-requests %d "
-                "--num-partition-keys %d --data-size %d --batch-size %d --log-level %d --sampling-rate %d "
-                "--use-token-aware %d --use-prepared %d --use-ssl %d --use-stdout %d\n",
-          hosts.c_str(), type.c_str(), label.c_str(), protocol_version,
+                "--num-partition-keys %lld --key-seed %llu --key-distribution %s --zipfian-exponent %g "
+                "--hotspot-keys %d --hotspot-ops %d --data-size %d --batch-size %d --batch-grouping %s --log-level %d --sampling-rate %d "
+                "--target-rate %d --duration %d --warmup %d --cooldown %d --ramp \"%s\" "
+                "--slo-p99 %d --slo-control %s "
+                "--use-token-aware %d --use-prepared %d --use-ssl %d --use-stdout %d "
+                "--use-sliding-window %d --use-adaptive-concurrency %d --use-mock-server %d --use-null-driver %d --mock-server-nodes %d "
+                "--mock-latency \"%s\" --mock-errors \"%s\" --mock-disconnect-interval %d "
+                "--sweep-num-io-threads \"%s\" --sweep-num-core-connections \"%s\" "
+                "--sweep-num-threads \"%s\" --sweep-num-concurrent-requests \"%s\" "
+                "--repeat %d --repeat-reprime %d --repeat-reconnect %d\n",
+          hosts.c_str(), port, type.c_str(), mix.c_str(), label.c_str(), reuse_dataset.c_str(), scenario_file.c_str(), protocol_version,
           num_threads, num_io_threads, num_core_connections, num_requests, num_concurrent_requests,
-          num_partition_keys, data_size, batch_size, static_cast<int>(log_level), sampling_rate,
-          use_token_aware, use_prepared, use_ssl, use_stdout);
+          static_cast<long long>(num_partition_keys), static_cast<unsigned long long>(key_seed),
+          key_distribution.c_str(), zipfian_exponent,
+          hotspot_keys, hotspot_ops, data_size, batch_size, batch_grouping.c_str(), static_cast<int>(log_level), sampling_rate,
+          target_rate, duration, warmup, cooldown, ramp,
+          slo_p99, slo_control.c_str(),
+          use_token_aware, use_prepared, use_ssl, use_stdout,
+          use_sliding_window, use_adaptive_concurrency, use_mock_server, use_null_driver, mock_server_nodes,
+          mock_latency.c_str(), mock_errors.c_str(), mock_disconnect_interval,
+          format_int_list(sweep_num_io_threads).c_str(), format_int_list(sweep_num_core_connections).c_str(),
+          format_int_list(sweep_num_threads).c_str(), format_int_list(sweep_num_concurrent_requests).c_str(),
+          repeat, repeat_reprime, repeat_reconnect);
 }
 
 std::string Config::filename() {
@@ -182,6 +499,56 @@ std::string Config::filename() {
     << "_" << num_io_threads << "io_threads"
     << "_" << num_core_connections << "core_connections";
 
+  if (type == "mixed") {
+    std::string ratios(mix);
+    ratios.erase(std::remove(ratios.begin(), ratios.end(), '='), ratios.end());
+    std::replace(ratios.begin(), ratios.end(), ',', '_');
+    s << "_" << ratios;
+  }
+
+  if (type.find("batch") != std::string::npos) {
+    s << "_" << batch_size << "batch_size_" << batch_grouping;
+  }
+
+  if (target_rate > 0) {
+    s << "_" << target_rate << "rate";
+  }
+
+  if (use_adaptive_concurrency) {
+    s << "_adaptive";
+  }
+
+  if (duration > 0) {
+    s << "_" << duration << "secs";
+  }
+
+  if (!ramp_type.empty()) {
+    s << "_" << ramp_type << "_ramp";
+  }
+
+  if (slo_p99 > 0) {
+    s << "_" << slo_p99 << "us_slo";
+  }
+
+  if (use_mock_server) {
+    s << "_mock";
+    if (mock_server_nodes > 1) {
+      s << "_" << mock_server_nodes << "nodes";
+    }
+  }
+
+  if (use_null_driver) {
+    s << "_null";
+  }
+
+  if (is_sweep()) {
+    s << "_sweep";
+  }
+
+  if (repeat > 1) {
+    s << "_" << repeat << "trials";
+  }
+
   if (!label.empty()) {
     s << "_" << label;
   }
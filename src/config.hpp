@@ -5,51 +5,120 @@
 
 #include <cstdio>
 #include <string>
+#include <vector>
 
 struct Config {
   Config()
     : hosts("127.0.0.1")
     , type("select")
+    , batch_grouping("same")
+    , mix("select=80,insert=20")
+    , key_distribution("sequential")
+    , slo_control("rate")
     , trusted_cert_file("trusted_cert.pem")
+    , port(9042)
+    , mock_server_nodes(1)
+    , mock_disconnect_interval(0)
     , num_threads(1)
     , num_io_threads(1)
     , num_core_connections(1)
     , num_requests(10000000)
     , num_concurrent_requests(5000)
     , num_partition_keys(999)
+    , key_seed(0)
     , data_size(1)
     , batch_size(1000)
+    , zipfian_exponent(0.99)
+    , hotspot_keys(20)
+    , hotspot_ops(80)
     , protocol_version(0)
     , log_level(CASS_LOG_ERROR)
     , sampling_rate(2000)
+    , target_rate(0)
+    , duration(0)
+    , warmup(0)
+    , cooldown(0)
+    , ramp_start(0)
+    , ramp_stop(0)
+    , ramp_step(0)
+    , slo_p99(0)
     , use_token_aware(true)
     , use_prepared(true)
     , use_ssl(false)
-    , use_stdout(false) { }
+    , use_stdout(false)
+    , use_sliding_window(false)
+    , use_adaptive_concurrency(false)
+    , use_mock_server(false)
+    , use_null_driver(false)
+    , repeat(1)
+    , repeat_reprime(false)
+    , repeat_reconnect(false) { }
 
   void from_cli(int argc, char** argv);
-  void dump(FILE* file);
+  void dump(FILE* file) const;
   std::string filename();
 
+  bool is_sweep() const {
+    return !sweep_num_io_threads.empty() || !sweep_num_core_connections.empty() ||
+        !sweep_num_threads.empty() || !sweep_num_concurrent_requests.empty();
+  }
+
   std::string hosts;
   std::string type;
+  std::string batch_grouping;
+  std::string mix;
+  std::string key_distribution;
+  std::string slo_control;
   std::string trusted_cert_file;
   std::string label;
+  std::string reuse_dataset;
+  std::string scenario_file;
+  std::string mock_latency; // e.g. "lognormal:500:0.5", empty for none
+  std::string mock_errors; // e.g. "overloaded=1,read_timeout=0.5"
+  int port;
+  int mock_server_nodes;
+  int mock_disconnect_interval; // In milliseconds, 0 for never
   int num_threads;
   int num_io_threads;
   int num_core_connections;
   int num_requests;
   int num_concurrent_requests;
-  int num_partition_keys;
+  int64_t num_partition_keys;
+  uint64_t key_seed;
   int data_size;
   int batch_size;
+  double zipfian_exponent;
+  int hotspot_keys;
+  int hotspot_ops;
   int protocol_version;
   CassLogLevel log_level;
   int sampling_rate;
+  int target_rate;
+  int duration;
+  int warmup;
+  int cooldown;
+  std::string ramp_type; // Empty unless stepping the load with --ramp
+  int ramp_start;
+  int ramp_stop;
+  int ramp_step;
+  int slo_p99; // In microseconds, 0 unless searching for the SLO's max load
   bool use_token_aware;
   bool use_prepared;
   bool use_ssl;
   bool use_stdout;
+  bool use_sliding_window;
+  bool use_adaptive_concurrency;
+  bool use_mock_server; // Runs against the in-process MockServer
+  bool use_null_driver; // The workloads' requests complete without being sent
+  int repeat;
+  bool repeat_reprime;
+  bool repeat_reconnect;
+  // Values swept in a single invocation, the settings above are used for
+  // any that are empty
+  std::vector<int> sweep_num_io_threads;
+  std::vector<int> sweep_num_core_connections;
+  std::vector<int> sweep_num_threads;
+  std::vector<int> sweep_num_concurrent_requests;
   std::string args_;
 };
 
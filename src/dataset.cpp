@@ -0,0 +1,73 @@
+#include "dataset.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define DATASET_MAGIC "CDBDATA"
+#define DATASET_VERSION 1
+
+// The on-disk layout of a dataset file
+struct DatasetHeader {
+  char magic[8];
+  uint32_t version;
+  int32_t data_size;
+  uint64_t key_seed;
+  int64_t num_keys;
+};
+
+bool Dataset::load(const std::string& filename) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(DatasetHeader))) {
+    close(fd);
+    return false;
+  }
+
+  void* mapped = mmap(NULL, sizeof(DatasetHeader), PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    return false;
+  }
+
+  const DatasetHeader* header = static_cast<const DatasetHeader*>(mapped);
+  bool is_valid = memcmp(header->magic, DATASET_MAGIC, sizeof(header->magic)) == 0 &&
+                  header->version == DATASET_VERSION;
+  if (is_valid) {
+    key_seed = header->key_seed;
+    num_keys = header->num_keys;
+    data_size = header->data_size;
+  } else {
+    fprintf(stderr, "Ignoring invalid dataset file '%s'\n", filename.c_str());
+  }
+
+  munmap(mapped, sizeof(DatasetHeader));
+  return is_valid;
+}
+
+bool Dataset::save(const std::string& filename) const {
+  DatasetHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, DATASET_MAGIC, sizeof(header.magic));
+  header.version = DATASET_VERSION;
+  header.data_size = data_size;
+  header.key_seed = key_seed;
+  header.num_keys = num_keys;
+
+  FILE* file = fopen(filename.c_str(), "wb");
+  if (file == NULL) {
+    fprintf(stderr, "Unable to write dataset file '%s'\n", filename.c_str());
+    return false;
+  }
+  bool is_written = fwrite(&header, sizeof(header), 1, file) == 1;
+  fclose(file);
+  return is_written;
+}
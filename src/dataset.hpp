@@ -0,0 +1,24 @@
+#ifndef DATASET_HPP
+#define DATASET_HPP
+
+#include <string>
+#include <stdint.h>
+
+// Describes the rows primed for the select workloads. Keys are derived from
+// the key seed (see KeySpace) so the seed and the number of keys is all that
+// later runs need to reuse the data without truncating and re-priming it.
+struct Dataset {
+  Dataset()
+    : key_seed(0)
+    , num_keys(0)
+    , data_size(0) { }
+
+  bool load(const std::string& filename);
+  bool save(const std::string& filename) const;
+
+  uint64_t key_seed;
+  int64_t num_keys;
+  int32_t data_size;
+};
+
+#endif // DATASET_HPP
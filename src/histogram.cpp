@@ -0,0 +1,126 @@
+#include "histogram.hpp"
+
+#include <cmath>
+
+// The first SUB_BUCKET_COUNT values are stored exactly, every power of two
+// after that is split into SUB_BUCKET_HALF_COUNT linear sub-buckets.
+#define SUB_BUCKET_BITS 10
+#define SUB_BUCKET_COUNT (1 << SUB_BUCKET_BITS)
+#define SUB_BUCKET_HALF_COUNT (SUB_BUCKET_COUNT / 2)
+#define MAX_VALUE_BITS 36
+#define MAX_VALUE ((static_cast<uint64_t>(1) << MAX_VALUE_BITS) - 1)
+#define BUCKET_COUNT (SUB_BUCKET_COUNT + (MAX_VALUE_BITS - SUB_BUCKET_BITS) * SUB_BUCKET_HALF_COUNT)
+
+Histogram::Histogram()
+  : counts_(new std::atomic<uint64_t>[BUCKET_COUNT])
+  , total_count_(0)
+  , total_sum_(0) {
+  reset();
+}
+
+void Histogram::record(uint64_t value) {
+  if (value > MAX_VALUE) {
+    value = MAX_VALUE;
+  }
+  counts_[index_of(value)].fetch_add(1, std::memory_order_relaxed);
+  total_sum_.fetch_add(value, std::memory_order_relaxed);
+  total_count_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Histogram::add(const Histogram& other) {
+  for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+    uint64_t count = other.counts_[i].load(std::memory_order_relaxed);
+    if (count > 0) {
+      counts_[i].fetch_add(count, std::memory_order_relaxed);
+    }
+  }
+  total_sum_.fetch_add(other.total_sum_.load(std::memory_order_relaxed),
+                       std::memory_order_relaxed);
+  total_count_.fetch_add(other.total_count_.load(std::memory_order_relaxed),
+                         std::memory_order_relaxed);
+}
+
+void Histogram::reset() {
+  for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+    counts_[i].store(0, std::memory_order_relaxed);
+  }
+  total_sum_.store(0, std::memory_order_relaxed);
+  total_count_.store(0, std::memory_order_relaxed);
+}
+
+uint64_t Histogram::min() const {
+  for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+    if (counts_[i].load(std::memory_order_relaxed) > 0) {
+      return lowest_value_at(i);
+    }
+  }
+  return 0;
+}
+
+uint64_t Histogram::max() const {
+  for (size_t i = BUCKET_COUNT; i > 0; --i) {
+    if (counts_[i - 1].load(std::memory_order_relaxed) > 0) {
+      return highest_value_at(i - 1);
+    }
+  }
+  return 0;
+}
+
+double Histogram::mean() const {
+  uint64_t count = total_count_.load(std::memory_order_relaxed);
+  if (count == 0) {
+    return 0.0;
+  }
+  return static_cast<double>(total_sum_.load(std::memory_order_relaxed)) / count;
+}
+
+uint64_t Histogram::percentile(double percentile) const {
+  uint64_t count = total_count_.load(std::memory_order_relaxed);
+  if (count == 0) {
+    return 0;
+  }
+
+  uint64_t target = static_cast<uint64_t>(std::ceil((percentile / 100.0) * count));
+  if (target == 0) {
+    target = 1;
+  }
+
+  uint64_t total = 0;
+  for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+    total += counts_[i].load(std::memory_order_relaxed);
+    if (total >= target) {
+      return highest_value_at(i);
+    }
+  }
+  return max();
+}
+
+size_t Histogram::index_of(uint64_t value) {
+  if (value < SUB_BUCKET_COUNT) {
+    return static_cast<size_t>(value);
+  }
+  int exponent = 63 - __builtin_clzll(value);
+  int shift = exponent - (SUB_BUCKET_BITS - 1);
+  size_t sub_bucket = static_cast<size_t>(value >> shift) - SUB_BUCKET_HALF_COUNT;
+  return SUB_BUCKET_COUNT + (exponent - SUB_BUCKET_BITS) * SUB_BUCKET_HALF_COUNT + sub_bucket;
+}
+
+uint64_t Histogram::lowest_value_at(size_t index) {
+  if (index < SUB_BUCKET_COUNT) {
+    return index;
+  }
+  index -= SUB_BUCKET_COUNT;
+  int shift = static_cast<int>(index / SUB_BUCKET_HALF_COUNT) + 1;
+  uint64_t sub_bucket = SUB_BUCKET_HALF_COUNT + index % SUB_BUCKET_HALF_COUNT;
+  return sub_bucket << shift;
+}
+
+uint64_t Histogram::highest_value_at(size_t index) {
+  if (index < SUB_BUCKET_COUNT) {
+    return index;
+  }
+  index -= SUB_BUCKET_COUNT;
+  int shift = static_cast<int>(index / SUB_BUCKET_HALF_COUNT) + 1;
+  uint64_t sub_bucket = SUB_BUCKET_HALF_COUNT + index % SUB_BUCKET_HALF_COUNT;
+  return ((sub_bucket + 1) << shift) - 1;
+}
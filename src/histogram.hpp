@@ -0,0 +1,36 @@
+#ifndef HISTOGRAM_HPP
+#define HISTOGRAM_HPP
+
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+
+// A log-linear latency histogram in the spirit of HdrHistogram. Values are
+// in nanoseconds and are tracked with a relative error below 0.2% up to
+// about 68 seconds (larger values are clamped). Recording is lock-free.
+class Histogram {
+public:
+  Histogram();
+
+  void record(uint64_t value);
+  void add(const Histogram& other);
+  void reset();
+
+  uint64_t count() const { return total_count_.load(std::memory_order_relaxed); }
+  uint64_t min() const;
+  uint64_t max() const;
+  double mean() const;
+  uint64_t percentile(double percentile) const;
+
+private:
+  static size_t index_of(uint64_t value);
+  static uint64_t lowest_value_at(size_t index);
+  static uint64_t highest_value_at(size_t index);
+
+private:
+  std::unique_ptr<std::atomic<uint64_t>[]> counts_;
+  std::atomic<uint64_t> total_count_;
+  std::atomic<uint64_t> total_sum_;
+};
+
+#endif // HISTOGRAM_HPP
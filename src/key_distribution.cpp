@@ -0,0 +1,139 @@
+#include "key_distribution.hpp"
+
+#include "random.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+KeyDistribution* KeyDistribution::create(const Config& config) {
+  const std::string& name = config.key_distribution;
+  if (name == "uniform") {
+    return new UniformKeyDistribution();
+  } else if (name == "sequential") {
+    return new SequentialKeyDistribution(config.num_threads);
+  } else if (name == "zipfian") {
+    return new ZipfianKeyDistribution(config.num_partition_keys, config.zipfian_exponent);
+  } else if (name == "hotspot") {
+    return new HotspotKeyDistribution(config.hotspot_keys, config.hotspot_ops);
+  } else if (name == "latest") {
+    return new LatestKeyDistribution(config.num_partition_keys, config.zipfian_exponent);
+  }
+  fprintf(stderr, "Invalid key distribution: %s\n", name.c_str());
+  exit(-1);
+  return NULL;
+}
+
+uint64_t UniformKeyDistribution::next(uint64_t num_keys) const {
+  return Random::local().next(num_keys);
+}
+
+static std::atomic<uint64_t> next_sequential_id(0);
+
+SequentialKeyDistribution::SequentialKeyDistribution(int num_threads)
+  : id_(next_sequential_id++)
+  , num_threads_(num_threads)
+  , next_thread_(0) { }
+
+uint64_t SequentialKeyDistribution::next(uint64_t num_keys) const {
+  // A thread's cursor for every instance it has used (e.g. the workloads of
+  // a mix), the first use claims the thread's starting key
+  static thread_local std::vector<std::pair<uint64_t, uint64_t> > cursors;
+  for (auto& cursor : cursors) {
+    if (cursor.first == id_) {
+      return cursor.second++ % num_keys;
+    }
+  }
+  uint64_t thread = next_thread_.fetch_add(1) % num_threads_;
+  uint64_t start = thread * num_keys / num_threads_;
+  cursors.push_back(std::make_pair(id_, start + 1));
+  return start % num_keys;
+}
+
+// (exp(x) - 1) / x, using a series expansion near zero for accuracy
+static double helper2(double x) {
+  if (std::fabs(x) > 1e-8) {
+    return std::expm1(x) / x;
+  }
+  return 1.0 + x * 0.5 * (1.0 + x * (1.0 / 3.0) * (1.0 + 0.25 * x));
+}
+
+// log(1 + x) / x, using a series expansion near zero for accuracy
+static double helper1(double x) {
+  if (std::fabs(x) > 1e-8) {
+    return std::log1p(x) / x;
+  }
+  return 1.0 - x * (0.5 - x * (1.0 / 3.0 - 0.25 * x));
+}
+
+ZipfianKeyDistribution::ZipfianKeyDistribution(uint64_t num_keys, double exponent)
+  : num_keys_(num_keys)
+  , exponent_(exponent) {
+  h_integral_x1_ = h_integral(1.5) - 1.0;
+  h_integral_num_keys_ = h_integral(num_keys_ + 0.5);
+  s_ = 2.0 - h_integral_inverse(h_integral(2.5) - h(2.0));
+}
+
+uint64_t ZipfianKeyDistribution::next(uint64_t num_keys) const {
+  return (sample() - 1) % num_keys;
+}
+
+uint64_t ZipfianKeyDistribution::sample() const {
+  Random& random = Random::local();
+  while (true) {
+    double u = h_integral_num_keys_ + random.next_double() * (h_integral_x1_ - h_integral_num_keys_);
+    double x = h_integral_inverse(u);
+    double k = std::floor(x + 0.5);
+    if (k < 1.0) {
+      k = 1.0;
+    } else if (k > num_keys_) {
+      k = static_cast<double>(num_keys_);
+    }
+    if (k - x <= s_ || u >= h_integral(k + 0.5) - h(k)) {
+      return static_cast<uint64_t>(k);
+    }
+  }
+}
+
+double ZipfianKeyDistribution::h(double x) const {
+  return std::exp(-exponent_ * std::log(x));
+}
+
+double ZipfianKeyDistribution::h_integral(double x) const {
+  double log_x = std::log(x);
+  return helper2((1.0 - exponent_) * log_x) * log_x;
+}
+
+double ZipfianKeyDistribution::h_integral_inverse(double x) const {
+  double t = x * (1.0 - exponent_);
+  if (t < -1.0) {
+    t = -1.0; // Limit value to the range [-1, +inf)
+  }
+  return std::exp(helper1(t) * x);
+}
+
+HotspotKeyDistribution::HotspotKeyDistribution(int hot_keys, int hot_ops)
+  : hot_keys_fraction_(hot_keys / 100.0)
+  , hot_ops_fraction_(hot_ops / 100.0) { }
+
+uint64_t HotspotKeyDistribution::next(uint64_t num_keys) const {
+  Random& random = Random::local();
+  uint64_t num_hot_keys = static_cast<uint64_t>(num_keys * hot_keys_fraction_);
+  if (num_hot_keys == 0) {
+    num_hot_keys = 1;
+  }
+  if (random.next_double() < hot_ops_fraction_ || num_hot_keys >= num_keys) {
+    return random.next(num_hot_keys);
+  }
+  return num_hot_keys + random.next(num_keys - num_hot_keys);
+}
+
+LatestKeyDistribution::LatestKeyDistribution(uint64_t num_keys, double exponent)
+  : zipfian_(num_keys, exponent) { }
+
+uint64_t LatestKeyDistribution::next(uint64_t num_keys) const {
+  uint64_t age = (zipfian_.sample() - 1) % num_keys;
+  return num_keys - 1 - age;
+}
@@ -0,0 +1,91 @@
+#ifndef KEY_DISTRIBUTION_HPP
+#define KEY_DISTRIBUTION_HPP
+
+#include "config.hpp"
+
+#include <atomic>
+#include <stdint.h>
+
+// Picks which key a request accesses. Generators are shared by all threads
+// so any mutable state is kept per thread (see Random::local()).
+class KeyDistribution {
+public:
+  virtual ~KeyDistribution() { }
+
+  // Returns the index of the next key to access in [0, num_keys)
+  virtual uint64_t next(uint64_t num_keys) const = 0;
+
+  static KeyDistribution* create(const Config& config);
+};
+
+class UniformKeyDistribution : public KeyDistribution {
+public:
+  virtual uint64_t next(uint64_t num_keys) const;
+};
+
+// Walks the keys in order. The submitting threads start evenly spaced
+// (thread i of n at key i * num_keys / n) so together the first num_keys
+// requests access every key once, without sharing a cursor.
+class SequentialKeyDistribution : public KeyDistribution {
+public:
+  SequentialKeyDistribution(int num_threads);
+
+  virtual uint64_t next(uint64_t num_keys) const;
+
+private:
+  const uint64_t id_; // Tells the instances apart in the threads' cursors
+  const int num_threads_;
+  mutable std::atomic<int> next_thread_;
+};
+
+// Key ranks follow a Zipf distribution with the given exponent. Samples are
+// drawn using rejection-inversion (Hormann and Derflinger) which needs no
+// precomputed tables so it's O(1) in both memory and setup time.
+class ZipfianKeyDistribution : public KeyDistribution {
+public:
+  ZipfianKeyDistribution(uint64_t num_keys, double exponent);
+
+  virtual uint64_t next(uint64_t num_keys) const;
+
+  // Returns a rank in [1, num_keys] where 1 is the most popular
+  uint64_t sample() const;
+
+private:
+  double h(double x) const;
+  double h_integral(double x) const;
+  double h_integral_inverse(double x) const;
+
+private:
+  const uint64_t num_keys_;
+  const double exponent_;
+  double h_integral_x1_;
+  double h_integral_num_keys_;
+  double s_;
+};
+
+// The first "hot_keys" percent of the keys receive "hot_ops" percent of the
+// requests, the rest are spread uniformly over the remaining keys
+class HotspotKeyDistribution : public KeyDistribution {
+public:
+  HotspotKeyDistribution(int hot_keys, int hot_ops);
+
+  virtual uint64_t next(uint64_t num_keys) const;
+
+private:
+  const double hot_keys_fraction_;
+  const double hot_ops_fraction_;
+};
+
+// Favors the most recently written keys (the highest indexes) with a Zipf
+// distribution over recency
+class LatestKeyDistribution : public KeyDistribution {
+public:
+  LatestKeyDistribution(uint64_t num_keys, double exponent);
+
+  virtual uint64_t next(uint64_t num_keys) const;
+
+private:
+  ZipfianKeyDistribution zipfian_;
+};
+
+#endif // KEY_DISTRIBUTION_HPP
@@ -0,0 +1,56 @@
+#ifndef KEY_SPACE_HPP
+#define KEY_SPACE_HPP
+
+#include "utils.hpp"
+
+#include <stdint.h>
+
+// Derives partition keys from key indexes using a seeded bijective hash so
+// that priming and reads agree on the keys without ever storing them. The
+// same seed always produces the same keys, which makes runs replayable.
+class KeySpace {
+public:
+  KeySpace(uint64_t seed)
+    : seed_(seed) { }
+
+  // Returns a version 4 UUID that is unique for every index below 2^62
+  Uuid key(uint64_t index) const {
+    Uuid uuid;
+    uuid.uuid.time_and_version = (mix64(index ^ seed_) & ~VERSION_MASK) | VERSION_4;
+    uuid.uuid.clock_seq_and_node = mix62(index ^ (seed_ & MASK_62)) | VARIANT;
+    return uuid;
+  }
+
+private:
+  // The version is the top nibble of time_and_version
+  static const uint64_t VERSION_MASK = 0xF000000000000000ULL;
+  static const uint64_t VERSION_4 = 0x4000000000000000ULL;
+  static const uint64_t VARIANT = 0x8000000000000000ULL;
+  static const uint64_t MASK_62 = 0x3FFFFFFFFFFFFFFFULL;
+
+  // The splitmix64 finalizer (every step is invertible)
+  static uint64_t mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    return x;
+  }
+
+  // The same steps restricted to 62 bits so the UUID variant bits are free
+  static uint64_t mix62(uint64_t x) {
+    x &= MASK_62;
+    x ^= x >> 30;
+    x = (x * 0xBF58476D1CE4E5B9ULL) & MASK_62;
+    x ^= x >> 27;
+    x = (x * 0x94D049BB133111EBULL) & MASK_62;
+    x ^= x >> 31;
+    return x;
+  }
+
+private:
+  const uint64_t seed_;
+};
+
+#endif // KEY_SPACE_HPP
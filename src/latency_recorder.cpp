@@ -0,0 +1,92 @@
+#include "latency_recorder.hpp"
+
+#include <limits>
+#include <thread>
+
+// Every thread that records gets a small process wide index the first time
+// it records. Threads beyond MAX_RECORDING_THREADS share histograms, which
+// is still correct because histograms are safe to record into concurrently.
+static std::atomic<size_t> next_thread_index(0);
+
+static size_t thread_index() {
+  static thread_local size_t index = next_thread_index++;
+  return index % MAX_RECORDING_THREADS;
+}
+
+// The odd phase counts up from the smallest value so its epochs are negative
+static const int64_t ODD_PHASE_EPOCH = std::numeric_limits<int64_t>::min();
+
+LatencyRecorder::LatencyRecorder()
+  : start_epoch_(0)
+  , even_end_epoch_(0)
+  , odd_end_epoch_(ODD_PHASE_EPOCH) {
+  for (size_t phase = 0; phase < 2; ++phase) {
+    for (size_t i = 0; i < MAX_RECORDING_THREADS; ++i) {
+      histograms_[phase][i].store(NULL, std::memory_order_relaxed);
+    }
+  }
+  uv_mutex_init(&mutex_);
+}
+
+LatencyRecorder::~LatencyRecorder() {
+  for (size_t phase = 0; phase < 2; ++phase) {
+    for (size_t i = 0; i < MAX_RECORDING_THREADS; ++i) {
+      delete histograms_[phase][i].load(std::memory_order_relaxed);
+    }
+  }
+  uv_mutex_destroy(&mutex_);
+}
+
+void LatencyRecorder::snapshot(Histogram* histogram) const {
+  uv_mutex_lock(&mutex_);
+  histogram->add(cumulative_);
+  int phase = start_epoch_.load(std::memory_order_acquire) < 0 ? 1 : 0;
+  for (size_t i = 0; i < MAX_RECORDING_THREADS; ++i) {
+    const Histogram* local = histograms_[phase][i].load(std::memory_order_acquire);
+    if (local != NULL) {
+      histogram->add(*local);
+    }
+  }
+  uv_mutex_unlock(&mutex_);
+}
+
+void LatencyRecorder::interval(Histogram* histogram) {
+  uv_mutex_lock(&mutex_);
+  int previous_phase = start_epoch_.load(std::memory_order_acquire) < 0 ? 1 : 0;
+  flip_phase();
+  for (size_t i = 0; i < MAX_RECORDING_THREADS; ++i) {
+    Histogram* local = histograms_[previous_phase][i].load(std::memory_order_acquire);
+    if (local != NULL) {
+      histogram->add(*local);
+      cumulative_.add(*local);
+      local->reset();
+    }
+  }
+  uv_mutex_unlock(&mutex_);
+}
+
+Histogram* LatencyRecorder::local(int phase) {
+  std::atomic<Histogram*>& slot = histograms_[phase][thread_index()];
+  Histogram* histogram = slot.load(std::memory_order_acquire);
+  if (histogram == NULL) {
+    Histogram* expected = NULL;
+    histogram = new Histogram();
+    if (!slot.compare_exchange_strong(expected, histogram)) {
+      delete histogram;
+      histogram = expected;
+    }
+  }
+  return histogram;
+}
+
+void LatencyRecorder::flip_phase() {
+  bool to_odd = start_epoch_.load(std::memory_order_acquire) >= 0;
+  int64_t initial_epoch = to_odd ? ODD_PHASE_EPOCH : 0;
+  (to_odd ? odd_end_epoch_ : even_end_epoch_).store(initial_epoch, std::memory_order_release);
+  int64_t start_epoch_at_flip = start_epoch_.exchange(initial_epoch, std::memory_order_acq_rel);
+  // Wait for the writers that started before the flip to finish
+  std::atomic<int64_t>& end_epoch = to_odd ? even_end_epoch_ : odd_end_epoch_;
+  while (end_epoch.load(std::memory_order_acquire) != start_epoch_at_flip) {
+    std::this_thread::yield();
+  }
+}
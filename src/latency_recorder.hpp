@@ -0,0 +1,50 @@
+#ifndef LATENCY_RECORDER_HPP
+#define LATENCY_RECORDER_HPP
+
+#include "histogram.hpp"
+
+#include <uv.h>
+
+#include <atomic>
+
+#define MAX_RECORDING_THREADS 256
+
+// Records latencies into a separate histogram for every recording thread
+// (submitting threads or the driver's IO threads) so recording never
+// contends. Each thread has two histograms: recorders write into the active
+// one while a reader drains the other, and the two are swapped every
+// interval. Recording never blocks; only readers take the lock.
+class LatencyRecorder {
+public:
+  LatencyRecorder();
+  ~LatencyRecorder();
+
+  void record(uint64_t latency_ns) {
+    int64_t epoch = start_epoch_.fetch_add(1, std::memory_order_acq_rel);
+    local(epoch < 0 ? 1 : 0)->record(latency_ns);
+    (epoch < 0 ? odd_end_epoch_ : even_end_epoch_).fetch_add(1, std::memory_order_release);
+  }
+
+  // Adds the latencies recorded so far into "histogram"
+  void snapshot(Histogram* histogram) const;
+
+  // Adds the latencies recorded since the previous call into "histogram"
+  void interval(Histogram* histogram);
+
+private:
+  Histogram* local(int phase);
+  void flip_phase();
+
+private:
+  // A writer/reader phaser: the sign of the start epoch selects the active
+  // histograms and the end epochs tell a reader when all the writers that
+  // started in the previous phase have finished.
+  std::atomic<int64_t> start_epoch_;
+  std::atomic<int64_t> even_end_epoch_;
+  std::atomic<int64_t> odd_end_epoch_;
+  std::atomic<Histogram*> histograms_[2][MAX_RECORDING_THREADS];
+  Histogram cumulative_;
+  mutable uv_mutex_t mutex_;
+};
+
+#endif // LATENCY_RECORDER_HPP
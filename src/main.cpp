@@ -1,95 +1,99 @@
 #include "barrier.hpp"
+#include "compare.hpp"
 #include "config.hpp"
-#include "callback_benchmark.hpp"
-#include "chunking_benchmark.hpp"
+#include "dataset.hpp"
 #include "driver.hpp"
+#include "mock_server.hpp"
+#include "runner.hpp"
+#include "scenario.hpp"
 #include "schema.hpp"
+#include "sweep.hpp"
+#include "trials.hpp"
 #include "utils.hpp"
 
-#include "date.h"
-
-#include <chrono>
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <uv.h>
 
 #include <unistd.h>
 
 
-CassCluster* create_cluster(const Config& config) {
-  CassCluster* cluster = cass_cluster_new();
+static void size_cluster_for(Config* cluster_config, const Config& workload) {
+  int num_concurrent_requests = workload.ramp_type == "concurrency" ? workload.ramp_stop
+                                                                    : workload.num_concurrent_requests;
+  cluster_config->num_concurrent_requests = std::max(cluster_config->num_concurrent_requests,
+                                                     num_concurrent_requests);
+  cluster_config->num_threads = std::max(cluster_config->num_threads, workload.num_threads);
+}
 
-  cass_cluster_set_contact_points(cluster, config.hosts.c_str());
+int main(int argc, char** argv) {
+  if (argc > 1 && strcmp(argv[1], "compare") == 0) {
+    return run_compare(argc - 2, argv + 2);
+  }
 
-#if 0
-  CassRetryPolicy* retry_policy = cass_retry_policy_fallthrough_new();
-  cass_cluster_set_retry_policy(cluster, retry_policy);
-  cass_retry_policy_free(retry_policy);
+  Config config;
+  std::unique_ptr<Benchmark> benchmark;
 
-  cass_cluster_set_latency_aware_routing(cluster, cass_true);
-#endif
+  config.from_cli(argc, argv);
 
-  cass_cluster_set_connect_timeout(cluster, 10000);
-  cass_cluster_set_reconnect_wait_time(cluster, 5000);
-  cass_cluster_set_tcp_keepalive(cluster, cass_true, 15);
+  cass_log_set_level(config.log_level);
 
-  if (config.use_ssl) {
-    CassSsl* ssl = cass_ssl_new();
-    cass_ssl_set_verify_flags(ssl, CASS_SSL_VERIFY_PEER_CERT);
-    if (!load_trusted_cert_file(config.trusted_cert_file.c_str(), ssl)) {
-      fprintf(stderr, "Failed to load certificate '%s' disabling peer verification\n",
-              config.trusted_cert_file.c_str());
-      cass_ssl_set_verify_flags(ssl, CASS_SSL_VERIFY_NONE);
+  // The mock server stands in for the cluster so a run measures the client
+  // alone. It's declared before the session so it outlives its connections.
+  std::unique_ptr<MockServer> mock_server;
+  if (config.use_mock_server) {
+    config.hosts = "127.0.0.1";
+    mock_server.reset(new MockServer(config));
+    if (!mock_server->start()) {
+      return -1;
     }
-    cass_cluster_set_ssl(cluster, ssl);
-    cass_ssl_free(ssl);
   }
 
-  if (config.protocol_version > 0 && cass_cluster_set_protocol_version(cluster, config.protocol_version) != CASS_OK) {
-    fprintf(stderr, "protocol version %d not supported using default\n", config.protocol_version);
+  // A previously primed dataset is reused when it has at least as many keys
+  // as requested and rows of the same size. Its key seed replaces ours so
+  // that reads hit the rows it describes.
+  Dataset dataset;
+  bool is_dataset_reused = false;
+  if (!config.reuse_dataset.empty() && dataset.load(config.reuse_dataset)) {
+    if (dataset.num_keys >= config.num_partition_keys && dataset.data_size == config.data_size) {
+      config.key_seed = dataset.key_seed;
+      is_dataset_reused = true;
+    } else {
+      fprintf(stderr, "Dataset '%s' doesn't match the requested keys or data size, re-priming\n",
+              config.reuse_dataset.c_str());
+    }
   }
 
-  cass_cluster_set_token_aware_routing(cluster, config.use_token_aware ? cass_true : cass_false);
-  cass_cluster_set_num_threads_io(cluster, config.num_io_threads);
-  cass_cluster_set_queue_size_io(cluster,
-                                 2 * config.num_concurrent_requests * std::max(config.num_threads, config.num_io_threads));
-
-  cass_cluster_set_core_connections_per_host(cluster, config.num_core_connections);
-  cass_cluster_set_max_connections_per_host(cluster, config.num_core_connections);
-
-  cass_cluster_set_pending_requests_high_water_mark(cluster,
-                                                    2 * config.num_concurrent_requests * std::max(config.num_threads, config.num_io_threads));
-  cass_cluster_set_write_bytes_high_water_mark(cluster, config.num_concurrent_requests * 16 * 1048576);
-
-  return cluster;
-}
-
-int main(int argc, char** argv) {
-  Config config;
-  std::unique_ptr<Benchmark> benchmark;
-
-  config.from_cli(argc, argv);
+  std::vector<Config> scenarios;
+  if (!config.scenario_file.empty()) {
+    scenarios = load_scenarios(config);
+  }
 
-  cass_log_set_level(config.log_level);
+  // The driver's queues are sized for the largest step of a ramp and the
+  // largest of the scenarios
+  Config cluster_config(config);
+  size_cluster_for(&cluster_config, config);
+  for (const auto& scenario : scenarios) {
+    size_cluster_for(&cluster_config, scenario);
+  }
 
   std::unique_ptr<CassCluster, decltype(&cass_cluster_free)> cluster(
-        create_cluster(config), cass_cluster_free);
+        create_cluster(cluster_config), cass_cluster_free);
 
   std::unique_ptr<CassSession, decltype(&cass_session_free)> session(
         cass_session_new(), cass_session_free);
 
-  if (config.type == "select") {
-    benchmark.reset(new SelectChunkingBenchmark(session.get(), config));
-  } else if (config.type == "insert") {
-    benchmark.reset(new InsertChunkingBenchmark(session.get(), config));
-  } else if (config.type == "selectcallback") {
-    benchmark.reset(new SelectCallbackBenchmark(session.get(), config));
-  } else if (config.type == "insertcallback") {
-    benchmark.reset(new InsertCallbackBenchmark(session.get(), config));
-  } else {
+  // Every run on the session shares its prepared statements
+  PreparedCache prepared_cache(session.get());
+
+  benchmark.reset(create_benchmark(session.get(), config));
+  if (!benchmark) {
     fprintf(stderr, "Invalid test type: %s\n", config.type.c_str());
     return -1;
   }
@@ -100,20 +104,39 @@ int main(int argc, char** argv) {
 
   execute_query(session.get(), KEYSPACE_SCHEMA);
   execute_query(session.get(), TABLE_SCHEMA);
-  execute_query(session.get(), TRUNCATE_TABLE);
+  execute_query(session.get(), BATCH_TABLE_SCHEMA);
+  execute_query(session.get(), COUNTER_TABLE_SCHEMA);
+  if (!is_dataset_reused) {
+    truncate_tables(session.get());
+  }
 
+  benchmark->set_prepared_cache(&prepared_cache);
   benchmark->setup();
 
+  int64_t num_primed_keys = 0;
+  uint64_t priming_start = uv_hrtime();
+  if (!is_dataset_reused) {
+    benchmark->prime();
+    num_primed_keys = benchmark->num_primed_keys();
+    if (!scenarios.empty()) {
+      num_primed_keys += prime_scenarios(session.get(), scenarios, &prepared_cache, num_primed_keys > 0);
+    }
+    if (!config.reuse_dataset.empty() && num_primed_keys > 0) {
+      dataset.key_seed = config.key_seed;
+      dataset.num_keys = config.num_partition_keys;
+      dataset.data_size = config.data_size;
+      dataset.save(config.reuse_dataset);
+    }
+  }
+
+  double priming_secs = (uv_hrtime() - priming_start) / (1000.0 * 1000.0 * 1000.0);
+
   close_session(session.get());
 
   if (connect_session(session.get(), cluster.get()) != CASS_OK) {
     return -1;
   }
 
-  uint64_t start = uv_hrtime();
-
-  benchmark->run();
-
   std::string filename = config.filename();
   std::unique_ptr<FILE, decltype(&fclose)> file(
         config.use_stdout ? stdout : fopen(filename.c_str(), "w"),
@@ -136,69 +159,40 @@ int main(int argc, char** argv) {
           "driver version", "server version", "num nodes",
           client_version.c_str(), server_version.c_str(), server_info.num_nodes);
 
-  bool first = true;
-  while (benchmark->poll(config.sampling_rate)) {
-#if CASS_VERSION_MAJOR >= 2
-    if (first) {
-      fprintf(file.get(),
-              "\n%30s, "
-              "%10s, %10s, %10s, %10s, "
-              "%10s, %10s, %10s, %10s, "
-              "%10s, %10s, %10s, %10s, "
-              "%10s\n",
-              "timestamp",
-              "mean rate", "1m rate", "5m rate", "10m rate",
-              "min", "mean", "median", "75th",
-              "95th", "98th", "99th", "99.9th",
-              "max");
-      first = false;
-    }
-    CassMetrics metrics;
-    cass_session_get_metrics(session.get(), &metrics);
-    std::string date(date::format("%F %T", std::chrono::system_clock::now()));
+  if (is_dataset_reused) {
     fprintf(file.get(),
-            "%30s, "
-            "%10g, %10g, %10g, %10g, "
-            "%10llu, %10llu, %10llu, %10llu, "
-            "%10llu, %10llu, %10llu, %10llu, "
-            "%10llu\n",
-            date.c_str(),
-            metrics.requests.mean_rate, metrics.requests.one_minute_rate,
-            metrics.requests.five_minute_rate, metrics.requests.fifteen_minute_rate,
-            (unsigned long long int)metrics.requests.min, (unsigned long long int)metrics.requests.mean,
-            (unsigned long long int)metrics.requests.median, (unsigned long long int)metrics.requests.percentile_75th,
-            (unsigned long long int)metrics.requests.percentile_95th, (unsigned long long int)metrics.requests.percentile_98th,
-            (unsigned long long int)metrics.requests.percentile_99th, (unsigned long long int)metrics.requests.percentile_999th,
-            (unsigned long long int)metrics.requests.max);
-#endif
+            "\n%16s, %20s\n"
+            "%16lld, %20llu\n",
+            "reused_keys", "key seed",
+            static_cast<long long>(dataset.num_keys), static_cast<unsigned long long>(dataset.key_seed));
+  } else if (num_primed_keys > 0) {
+    fprintf(file.get(),
+            "\n%16s, %10s, %12s\n"
+            "%16lld, %10g, %12g\n",
+            "num_primed_keys", "duration", "priming rate",
+            static_cast<long long>(num_primed_keys), priming_secs,
+            num_primed_keys / priming_secs);
   }
 
-  double elapsed_secs = (uv_hrtime() - start) / (1000.0 * 1000.0 * 1000.0);
+  // Only the workloads' requests count, not the schema and priming
+  if (mock_server) {
+    mock_server->start_workloads();
+  }
 
-  CassMetrics metrics;
-  cass_session_get_metrics(session.get(), &metrics);
+  if (config.is_sweep()) {
+    close_session(session.get());
+    run_sweep(config, file.get());
+  } else if (!scenarios.empty()) {
+    run_scenarios(session.get(), scenarios, &prepared_cache, file.get());
+  } else if (config.repeat > 1) {
+    run_trials(session.get(), cluster.get(), config, &prepared_cache, mock_server.get(), file.get());
+  } else {
+    run_workload(session.get(), config, &prepared_cache, false, file.get());
+  }
 
-  fprintf(file.get(),
-          "\n%12s, %10s, %10s,"
-          "%10s, %10s, %10s, %10s, "
-          "%10s, %10s, %10s, %10s, "
-          "%10s\n"
-          "%12d, %10g, %10g,"
-          "%10llu, %10llu, %10llu, %10llu, "
-          "%10llu, %10llu, %10llu, %10llu, "
-          "%10llu\n",
-          "num_requests", "duration", "final rate",
-          "min", "mean", "median", "75th",
-          "95th", "98th", "99th", "99.9th",
-          "max",
-          config.num_requests, elapsed_secs, config.num_requests / elapsed_secs,
-          (unsigned long long int)metrics.requests.min, (unsigned long long int)metrics.requests.mean,
-          (unsigned long long int)metrics.requests.median, (unsigned long long int)metrics.requests.percentile_75th,
-          (unsigned long long int)metrics.requests.percentile_95th, (unsigned long long int)metrics.requests.percentile_98th,
-          (unsigned long long int)metrics.requests.percentile_99th, (unsigned long long int)metrics.requests.percentile_999th,
-          (unsigned long long int)metrics.requests.max);
-
-  benchmark->join();
+  if (mock_server) {
+    mock_server->print_counts(file.get());
+  }
 
   return 0;
 }
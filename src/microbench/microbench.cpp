@@ -0,0 +1,414 @@
+#include "config.hpp"
+#include "driver.hpp"
+#include "mock_server.hpp"
+#include "utils.hpp"
+
+#include <uv.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+
+// Microbenchmarks of the driver calls on the harness's hot path, meant for
+// tracking the cost of the driver's encoding layer across versions. None of
+// them send a request: statements, batches, collections and UUIDs are built
+// locally, and values are decoded from a result fetched once from the
+// in-process MockServer. Every allocation of the driver goes through
+// cass_alloc_set_functions() so each benchmark reports its allocations too.
+
+#define DEFAULT_ITERATIONS 1000000
+#define DEFAULT_DATA_SIZE 100
+#define DEFAULT_MOCK_PORT 29042
+#define BATCH_SIZE 10
+#define COLLECTION_SIZE 10
+
+#define CHECK_ARG(name)                                       \
+  if (i + 1 >= argc) {                                        \
+    fprintf(stderr, "%s requires an argument\n", name);       \
+    exit(-1);                                                 \
+  }
+
+#define KEYSPACE_QUERY                                                                   \
+  "CREATE KEYSPACE IF NOT EXISTS microbench WITH "                                       \
+  "replication = { 'class': 'SimpleStrategy', 'replication_factor': '1' }"
+#define TABLE_QUERY                                                                      \
+  "CREATE TABLE IF NOT EXISTS microbench.typed_values (key uuid PRIMARY KEY, text_value text, " \
+  "int_value int, bigint_value bigint, double_value double, boolean_value boolean, "     \
+  "inet_value inet)"
+#define SELECT_QUERY                                                                     \
+  "SELECT key, text_value, int_value, bigint_value, double_value, boolean_value, "       \
+  "inet_value FROM microbench.typed_values WHERE key = ?"
+#define INSERT_QUERY "INSERT INTO microbench.typed_values (key, text_value) VALUES (?, ?)"
+
+struct Options {
+  Options()
+    : iterations(DEFAULT_ITERATIONS)
+    , data_size(DEFAULT_DATA_SIZE)
+    , port(DEFAULT_MOCK_PORT) { }
+
+  int iterations;
+  int data_size;
+  int port;
+  std::string filter; // Only the benchmarks whose name contains it
+};
+
+// Only counted, the memory itself comes from the C library. Allocations made
+// before the functions are set (e.g. by static initializers) are freed
+// through them too, which is safe for the same reason.
+static std::atomic<uint64_t> num_allocs(0);
+static std::atomic<uint64_t> num_alloc_bytes(0);
+
+static void* counting_malloc(size_t size) {
+  num_allocs.fetch_add(1, std::memory_order_relaxed);
+  num_alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+  return malloc(size);
+}
+
+static void* counting_realloc(void* ptr, size_t size) {
+  num_allocs.fetch_add(1, std::memory_order_relaxed);
+  num_alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+  return realloc(ptr, size);
+}
+
+static void counting_free(void* ptr) {
+  free(ptr);
+}
+
+// Keeps decoded values alive so the calls producing them aren't optimized out
+static volatile uint64_t sink;
+
+static void parse_options(int argc, char** argv, Options* options) {
+  for (int i = 1; i < argc; ++i) {
+    const char* arg = argv[i];
+    if (strcmp(arg, "--iterations") == 0) {
+      CHECK_ARG("--iterations");
+      options->iterations = atoi(argv[++i]);
+      if (options->iterations <= 0) {
+        fprintf(stderr, "--iterations has the invalid value %d\n", options->iterations);
+        exit(-1);
+      }
+    } else if (strcmp(arg, "--data-size") == 0) {
+      CHECK_ARG("--data-size");
+      options->data_size = atoi(argv[++i]);
+      if (options->data_size < 0) {
+        fprintf(stderr, "--data-size has the invalid value %d\n", options->data_size);
+        exit(-1);
+      }
+    } else if (strcmp(arg, "--port") == 0) {
+      CHECK_ARG("--port");
+      options->port = atoi(argv[++i]);
+    } else if (strcmp(arg, "--filter") == 0) {
+      CHECK_ARG("--filter");
+      options->filter = argv[++i];
+    } else if (strcmp(arg, "--help") == 0) {
+      printf("Usage: %s [--iterations <n>] [--data-size <bytes>] [--port <mock port>] [--filter <name>]\n",
+             argv[0]);
+      exit(0);
+    } else {
+      fprintf(stderr, "Invalid argument: %s\n", arg);
+      exit(-1);
+    }
+  }
+}
+
+// Runs "op" a tenth of the iterations to warm up and then times it
+template <class Op>
+static void run(const char* name, const Options& options, Op op) {
+  if (!options.filter.empty() && strstr(name, options.filter.c_str()) == NULL) {
+    return;
+  }
+
+  for (int i = options.iterations / 10; i > 0; --i) {
+    op();
+  }
+
+  uint64_t allocs_start = num_allocs.load(std::memory_order_relaxed);
+  uint64_t alloc_bytes_start = num_alloc_bytes.load(std::memory_order_relaxed);
+  uint64_t start = uv_hrtime();
+  for (int i = options.iterations; i > 0; --i) {
+    op();
+  }
+  uint64_t elapsed = uv_hrtime() - start;
+
+  double iterations = options.iterations;
+  printf("%28s, %12d, %10.1f, %10.2f, %10.1f\n",
+         name, options.iterations, elapsed / iterations,
+         (num_allocs.load(std::memory_order_relaxed) - allocs_start) / iterations,
+         (num_alloc_bytes.load(std::memory_order_relaxed) - alloc_bytes_start) / iterations);
+}
+
+static void run_statement_benchmarks(const Options& options, const CassPrepared* prepared) {
+  const std::string data(generate_data(options.data_size));
+  Uuid key = generate_random_uuid();
+
+  run("statement_new", options, [&]() {
+    cass_statement_free(cass_statement_new(STRING_PARAM(INSERT_QUERY), 2));
+  });
+
+  // The insert workloads' request: a new statement with a key and a value
+  run("statement_new_bind", options, [&]() {
+    CassStatement* statement = cass_statement_new(STRING_PARAM(INSERT_QUERY), 2);
+    cass_statement_bind_uuid(statement, 0, key);
+    cass_statement_bind_string_n(statement, 1, data.c_str(), data.size());
+    cass_statement_free(statement);
+  });
+
+  // The select workloads' request
+  if (prepared) {
+    run("prepared_bind", options, [&]() {
+      CassStatement* statement = cass_prepared_bind(prepared);
+      cass_statement_bind_uuid(statement, 0, key);
+      cass_statement_free(statement);
+    });
+  }
+}
+
+static void run_bind_benchmarks(const Options& options) {
+  const std::string data(generate_data(options.data_size));
+  Uuid uuid = generate_random_uuid();
+  CassInet inet = cass_inet_init_v4(reinterpret_cast<const cass_uint8_t*>("\x7F\x00\x00\x01"));
+  const cass_uint8_t varint[] = { 0x01, 0x00 };
+
+  CassCollection* collection = cass_collection_new(CASS_COLLECTION_TYPE_LIST, COLLECTION_SIZE);
+  for (int i = 0; i < COLLECTION_SIZE; ++i) {
+    cass_collection_append_int32(collection, i);
+  }
+
+  // Binding over the previous value of the same parameter, like a reused
+  // statement would
+  CassStatement* statement = cass_statement_new(STRING_PARAM(INSERT_QUERY), 1);
+
+  run("bind_null", options, [&]() { cass_statement_bind_null(statement, 0); });
+  run("bind_bool", options, [&]() { cass_statement_bind_bool(statement, 0, cass_true); });
+  run("bind_int8", options, [&]() { cass_statement_bind_int8(statement, 0, 1); });
+  run("bind_int16", options, [&]() { cass_statement_bind_int16(statement, 0, 1); });
+  run("bind_int32", options, [&]() { cass_statement_bind_int32(statement, 0, 1); });
+  run("bind_uint32", options, [&]() { cass_statement_bind_uint32(statement, 0, 1); });
+  run("bind_int64", options, [&]() { cass_statement_bind_int64(statement, 0, 1); });
+  run("bind_float", options, [&]() { cass_statement_bind_float(statement, 0, 1.0f); });
+  run("bind_double", options, [&]() { cass_statement_bind_double(statement, 0, 1.0); });
+  run("bind_decimal", options, [&]() {
+    cass_statement_bind_decimal(statement, 0, varint, sizeof(varint), 2);
+  });
+  run("bind_string", options, [&]() {
+    cass_statement_bind_string_n(statement, 0, data.c_str(), data.size());
+  });
+  run("bind_bytes", options, [&]() {
+    cass_statement_bind_bytes(statement, 0, reinterpret_cast<const cass_byte_t*>(data.data()), data.size());
+  });
+  run("bind_uuid", options, [&]() { cass_statement_bind_uuid(statement, 0, uuid); });
+  run("bind_inet", options, [&]() { cass_statement_bind_inet(statement, 0, inet); });
+  run("bind_collection", options, [&]() { cass_statement_bind_collection(statement, 0, collection); });
+
+  cass_statement_free(statement);
+  cass_collection_free(collection);
+}
+
+static void run_batch_benchmarks(const Options& options) {
+  const std::string data(generate_data(options.data_size));
+  CassStatement* statement = cass_statement_new(STRING_PARAM(INSERT_QUERY), 2);
+  cass_statement_bind_uuid(statement, 0, generate_random_uuid());
+  cass_statement_bind_string_n(statement, 1, data.c_str(), data.size());
+
+  // A batch of BATCH_SIZE statements per operation
+  run("batch_add_statement_x10", options, [&]() {
+    CassBatch* batch = cass_batch_new(CASS_BATCH_TYPE_LOGGED);
+    for (int i = 0; i < BATCH_SIZE; ++i) {
+      cass_batch_add_statement(batch, statement);
+    }
+    cass_batch_free(batch);
+  });
+
+  cass_statement_free(statement);
+}
+
+static void run_uuid_benchmarks(const Options& options) {
+  CassUuidGen* uuid_gen = cass_uuid_gen_new();
+  CassUuid uuid;
+
+  run("uuid_gen_random", options, [&]() {
+    cass_uuid_gen_random(uuid_gen, &uuid);
+    sink = uuid.clock_seq_and_node;
+  });
+  run("uuid_gen_time", options, [&]() {
+    cass_uuid_gen_time(uuid_gen, &uuid);
+    sink = uuid.time_and_version;
+  });
+
+  cass_uuid_gen_free(uuid_gen);
+}
+
+static void run_collection_benchmarks(const Options& options) {
+  const std::string data(generate_data(options.data_size));
+
+  // A collection of COLLECTION_SIZE elements per operation
+  run("collection_list_int32_x10", options, [&]() {
+    CassCollection* collection = cass_collection_new(CASS_COLLECTION_TYPE_LIST, COLLECTION_SIZE);
+    for (int i = 0; i < COLLECTION_SIZE; ++i) {
+      cass_collection_append_int32(collection, i);
+    }
+    cass_collection_free(collection);
+  });
+  run("collection_set_text_x10", options, [&]() {
+    CassCollection* collection = cass_collection_new(CASS_COLLECTION_TYPE_SET, COLLECTION_SIZE);
+    for (int i = 0; i < COLLECTION_SIZE; ++i) {
+      cass_collection_append_string_n(collection, data.c_str(), data.size());
+    }
+    cass_collection_free(collection);
+  });
+}
+
+static void run_decode_benchmarks(const Options& options, const CassResult* result) {
+  run("result_iterate", options, [&]() {
+    CassIterator* rows = cass_iterator_from_result(result);
+    while (cass_iterator_next(rows)) {
+      sink = reinterpret_cast<uintptr_t>(cass_iterator_get_row(rows));
+    }
+    cass_iterator_free(rows);
+  });
+
+  const CassRow* row = cass_result_first_row(result);
+  if (!row) {
+    fprintf(stderr, "The decoded result has no rows\n");
+    return;
+  }
+
+  run("row_get_column", options, [&]() {
+    sink = reinterpret_cast<uintptr_t>(cass_row_get_column(row, 1));
+  });
+  run("row_get_column_by_name", options, [&]() {
+    sink = reinterpret_cast<uintptr_t>(cass_row_get_column_by_name(row, "text_value"));
+  });
+
+  const CassValue* key_value = cass_row_get_column(row, 0);
+  const CassValue* text_value = cass_row_get_column(row, 1);
+  const CassValue* int_value = cass_row_get_column(row, 2);
+  const CassValue* bigint_value = cass_row_get_column(row, 3);
+  const CassValue* double_value = cass_row_get_column(row, 4);
+  const CassValue* boolean_value = cass_row_get_column(row, 5);
+  const CassValue* inet_value = cass_row_get_column(row, 6);
+
+  run("value_get_uuid", options, [&]() {
+    CassUuid uuid;
+    cass_value_get_uuid(key_value, &uuid);
+    sink = uuid.time_and_version;
+  });
+  run("value_get_string", options, [&]() {
+    const char* text;
+    size_t text_length;
+    cass_value_get_string(text_value, &text, &text_length);
+    sink = text_length;
+  });
+  run("value_get_int32", options, [&]() {
+    cass_int32_t value;
+    cass_value_get_int32(int_value, &value);
+    sink = value;
+  });
+  run("value_get_int64", options, [&]() {
+    cass_int64_t value;
+    cass_value_get_int64(bigint_value, &value);
+    sink = value;
+  });
+  run("value_get_double", options, [&]() {
+    cass_double_t value;
+    cass_value_get_double(double_value, &value);
+    sink = static_cast<uint64_t>(value);
+  });
+  run("value_get_bool", options, [&]() {
+    cass_bool_t value;
+    cass_value_get_bool(boolean_value, &value);
+    sink = value;
+  });
+  run("value_get_inet", options, [&]() {
+    CassInet value;
+    cass_value_get_inet(inet_value, &value);
+    sink = value.address_length;
+  });
+}
+
+// Fetches a result and prepares the select of the workloads on a session
+// connected to the mock server. Both outlive the session.
+static bool fetch_from_mock_server(const Options& options,
+                                   const CassResult** result, const CassPrepared** prepared) {
+  Config config;
+  config.port = options.port;
+  config.data_size = options.data_size;
+  config.use_mock_server = true;
+  MockServer server(config);
+  if (!server.start()) {
+    return false;
+  }
+
+  std::unique_ptr<CassCluster, decltype(&cass_cluster_free)> cluster(
+        cass_cluster_new(), cass_cluster_free);
+  cass_cluster_set_contact_points(cluster.get(), "127.0.0.1");
+  cass_cluster_set_port(cluster.get(), options.port);
+
+  std::unique_ptr<CassSession, decltype(&cass_session_free)> session(
+        cass_session_new(), cass_session_free);
+  if (connect_session(session.get(), cluster.get()) != CASS_OK) {
+    return false;
+  }
+
+  bool is_fetched = false;
+  if (execute_query(session.get(), KEYSPACE_QUERY) == CASS_OK &&
+      execute_query(session.get(), TABLE_QUERY) == CASS_OK &&
+      prepare_query(session.get(), SELECT_QUERY, prepared) == CASS_OK) {
+    CassStatement* statement = cass_prepared_bind(*prepared);
+    cass_statement_bind_uuid(statement, 0, generate_random_uuid());
+    CassFuture* future = cass_session_execute(session.get(), statement);
+    if (cass_future_error_code(future) == CASS_OK) {
+      *result = cass_future_get_result(future);
+      is_fetched = true;
+    } else {
+      print_error(future);
+    }
+    cass_future_free(future);
+    cass_statement_free(statement);
+  }
+
+  close_session(session.get());
+  return is_fetched;
+}
+
+int main(int argc, char** argv) {
+  // Before any other call so that every allocation of the driver is counted
+  cass_alloc_set_functions(counting_malloc, counting_realloc, counting_free);
+  cass_log_set_level(CASS_LOG_ERROR);
+
+  Options options;
+  parse_options(argc, argv, &options);
+
+  const CassResult* result = NULL;
+  const CassPrepared* prepared = NULL;
+  if (!fetch_from_mock_server(options, &result, &prepared)) {
+    fprintf(stderr, "Unable to fetch a result from the mock server, skipping the decoding benchmarks\n");
+  }
+
+  printf("\n%20s, %10s, %10s\n"
+         "%20s, %10d, %10d\n",
+         "driver version", "iterations", "data size",
+         driver_version().c_str(), options.iterations, options.data_size);
+
+  printf("\n%28s, %12s, %10s, %10s, %10s\n",
+         "benchmark", "iterations", "ns/op", "allocs/op", "bytes/op");
+  run_statement_benchmarks(options, prepared);
+  run_bind_benchmarks(options);
+  run_batch_benchmarks(options);
+  run_uuid_benchmarks(options);
+  run_collection_benchmarks(options);
+  if (result) {
+    run_decode_benchmarks(options, result);
+  }
+
+  if (result) {
+    cass_result_free(result);
+  }
+  if (prepared) {
+    cass_prepared_free(prepared);
+  }
+  return 0;
+}
@@ -0,0 +1,1671 @@
+#include "mock_server.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iterator>
+#include <sstream>
+#include <stdint.h>
+
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+
+#define MIN_PROTOCOL_VERSION 3
+#define MAX_PROTOCOL_VERSION 4
+#define MAX_FRAME_LENGTH (256 * 1024 * 1024)
+#define READ_BUFFER_SIZE (64 * 1024)
+
+#define OPCODE_ERROR 0x00
+#define OPCODE_STARTUP 0x01
+#define OPCODE_READY 0x02
+#define OPCODE_OPTIONS 0x05
+#define OPCODE_SUPPORTED 0x06
+#define OPCODE_QUERY 0x07
+#define OPCODE_RESULT 0x08
+#define OPCODE_PREPARE 0x09
+#define OPCODE_EXECUTE 0x0A
+#define OPCODE_REGISTER 0x0B
+#define OPCODE_BATCH 0x0D
+
+#define RESULT_VOID 0x0001
+#define RESULT_ROWS 0x0002
+#define RESULT_SET_KEYSPACE 0x0003
+#define RESULT_PREPARED 0x0004
+
+#define METADATA_GLOBAL_TABLES_SPEC 0x0001
+#define METADATA_NO_METADATA 0x0004
+
+#define QUERY_FLAG_VALUES 0x01
+#define QUERY_FLAG_SKIP_METADATA 0x02
+#define QUERY_FLAG_NAMES_FOR_VALUES 0x40
+
+#define BATCH_KIND_PREPARED 1
+
+#define ERROR_UNAVAILABLE 0x1000
+#define ERROR_OVERLOADED 0x1001
+#define ERROR_READ_TIMEOUT 0x1200
+#define ERROR_PROTOCOL 0x000A
+#define ERROR_INVALID 0x2200
+#define ERROR_UNPREPARED 0x2500
+
+#define TYPE_ASCII 0x0001
+#define TYPE_BIGINT 0x0002
+#define TYPE_BLOB 0x0003
+#define TYPE_BOOLEAN 0x0004
+#define TYPE_COUNTER 0x0005
+#define TYPE_DECIMAL 0x0006
+#define TYPE_DOUBLE 0x0007
+#define TYPE_FLOAT 0x0008
+#define TYPE_INT 0x0009
+#define TYPE_TIMESTAMP 0x000B
+#define TYPE_UUID 0x000C
+#define TYPE_VARCHAR 0x000D
+#define TYPE_VARINT 0x000E
+#define TYPE_TIMEUUID 0x000F
+#define TYPE_INET 0x0010
+#define TYPE_DATE 0x0011
+#define TYPE_TIME 0x0012
+#define TYPE_SMALLINT 0x0013
+#define TYPE_TINYINT 0x0014
+#define TYPE_MAP 0x0021
+#define TYPE_SET 0x0022
+
+#define CONSISTENCY_ONE 0x0001
+
+#define LATENCY_NONE 0
+#define LATENCY_FIXED 1
+#define LATENCY_LOGNORMAL 2
+#define LATENCY_GC 3
+
+#define NANOS_PER_MILLI (1000 * 1000)
+#define TWO_PI 6.283185307179586
+
+#define RELEASE_VERSION "3.11.4"
+#define CQL_VERSION "3.4.4"
+#define PARTITIONER "org.apache.cassandra.dht.Murmur3Partitioner"
+
+struct MockServer::Connection {
+  Connection(Node* node)
+    : node(node)
+    , server(node->server)
+    , num_delayed(0)
+    , is_closing(false)
+    , is_closed(false) {
+    tcp.data = this;
+  }
+
+  uv_tcp_t tcp;
+  Node* node;
+  MockServer* server;
+  // A closed connection is kept until its delayed responses are dropped
+  int num_delayed;
+  bool is_closing;
+  bool is_closed;
+  std::string input;
+  char buffer[READ_BUFFER_SIZE];
+};
+
+// Responses are written straight out of the canned bodies. A write only
+// owns the frame headers and the few bodies and statements that are built
+// per request.
+struct MockServer::Write {
+  struct Response {
+    size_t header_offset;
+    size_t header_size;
+    const std::string* body;
+  };
+
+  Write() {
+    req.data = this;
+  }
+
+  uv_write_t req;
+  std::string headers;
+  std::deque<std::string> bodies;
+  std::deque<Statement> statements;
+  std::vector<Response> responses;
+  std::vector<uv_buf_t> bufs;
+};
+
+static void encode_byte(std::string* buffer, int value) {
+  buffer->push_back(static_cast<char>(value & 0xFF));
+}
+
+static void encode_short(std::string* buffer, int value) {
+  buffer->push_back(static_cast<char>((value >> 8) & 0xFF));
+  buffer->push_back(static_cast<char>(value & 0xFF));
+}
+
+static void encode_int(std::string* buffer, int32_t value) {
+  uint32_t bits = static_cast<uint32_t>(value);
+  for (int shift = 24; shift >= 0; shift -= 8) {
+    buffer->push_back(static_cast<char>((bits >> shift) & 0xFF));
+  }
+}
+
+static void encode_string(std::string* buffer, const std::string& value) {
+  encode_short(buffer, static_cast<int>(value.size()));
+  buffer->append(value);
+}
+
+static void encode_bytes(std::string* buffer, const std::string& value) {
+  encode_int(buffer, static_cast<int32_t>(value.size()));
+  buffer->append(value);
+}
+
+static std::string bytes_value(const std::string& value) {
+  std::string bytes;
+  encode_bytes(&bytes, value);
+  return bytes;
+}
+
+static std::string uuid_value(uint64_t high, uint64_t low) {
+  std::string uuid;
+  for (int shift = 56; shift >= 0; shift -= 8) {
+    uuid.push_back(static_cast<char>((high >> shift) & 0xFF));
+  }
+  for (int shift = 56; shift >= 0; shift -= 8) {
+    uuid.push_back(static_cast<char>((low >> shift) & 0xFF));
+  }
+  return bytes_value(uuid);
+}
+
+static std::string inet_value(const std::string& address) {
+  struct sockaddr_in addr;
+  uv_ip4_addr(address.c_str(), 0, &addr);
+  return bytes_value(std::string(reinterpret_cast<const char*>(&addr.sin_addr), 4));
+}
+
+static std::string set_value(const std::vector<std::string>& elements) {
+  std::string set;
+  encode_int(&set, static_cast<int32_t>(elements.size()));
+  for (const auto& element : elements) {
+    encode_bytes(&set, element);
+  }
+  return bytes_value(set);
+}
+
+static std::string type_option(int type) {
+  std::string option;
+  encode_short(&option, type);
+  return option;
+}
+
+static std::string error_body(int code, const std::string& message) {
+  std::string body;
+  encode_int(&body, code);
+  encode_string(&body, message);
+  return body;
+}
+
+// Prepared ids only have to be stable for the life of the server
+static std::string statement_id(const std::string& query) {
+  uint64_t hash = 14695981039346656037ULL; // FNV-1a
+  for (char c : query) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 1099511628211ULL;
+  }
+  std::string id;
+  for (int shift = 56; shift >= 0; shift -= 8) {
+    id.push_back(static_cast<char>((hash >> shift) & 0xFF));
+  }
+  return id;
+}
+
+// Reads the big-endian integers and strings of a frame body
+class Decoder {
+public:
+  Decoder(const char* data, size_t size)
+    : pos_(reinterpret_cast<const uint8_t*>(data))
+    , end_(pos_ + size) { }
+
+  bool decode_byte(int* value) {
+    if (end_ - pos_ < 1) return false;
+    *value = *pos_++;
+    return true;
+  }
+
+  bool decode_short(int* value) {
+    if (end_ - pos_ < 2) return false;
+    *value = (pos_[0] << 8) | pos_[1];
+    pos_ += 2;
+    return true;
+  }
+
+  bool decode_int(int32_t* value) {
+    if (end_ - pos_ < 4) return false;
+    *value = static_cast<int32_t>((static_cast<uint32_t>(pos_[0]) << 24) | (pos_[1] << 16) |
+                                  (pos_[2] << 8) | pos_[3]);
+    pos_ += 4;
+    return true;
+  }
+
+  bool decode_long_string(std::string* value) {
+    int32_t size;
+    if (!decode_int(&size) || size < 0 || end_ - pos_ < size) return false;
+    value->assign(reinterpret_cast<const char*>(pos_), size);
+    pos_ += size;
+    return true;
+  }
+
+  bool decode_short_bytes(std::string* value) {
+    int size;
+    if (!decode_short(&size) || end_ - pos_ < size) return false;
+    value->assign(reinterpret_cast<const char*>(pos_), size);
+    pos_ += size;
+    return true;
+  }
+
+  // A [value] is null when its size is -1 and unset when it's -2
+  bool decode_value(const char** value, int32_t* size) {
+    if (!decode_int(size) || end_ - pos_ < std::max(*size, 0)) return false;
+    *value = reinterpret_cast<const char*>(pos_);
+    pos_ += std::max(*size, 0);
+    return true;
+  }
+
+  bool skip(size_t size) {
+    if (static_cast<size_t>(end_ - pos_) < size) return false;
+    pos_ += size;
+    return true;
+  }
+
+  const char* position() const { return reinterpret_cast<const char*>(pos_); }
+  size_t remaining() const { return end_ - pos_; }
+
+private:
+  const uint8_t* pos_;
+  const uint8_t* end_;
+};
+
+// Splits a statement into lowercase identifiers, string literals and
+// punctuation. Comparison operators are kept whole.
+static std::vector<std::string> tokenize(const std::string& query) {
+  std::vector<std::string> tokens;
+  size_t i = 0;
+  while (i < query.size()) {
+    char c = query[i];
+    if (isspace(static_cast<unsigned char>(c))) {
+      i++;
+    } else if (c == '\'') {
+      size_t end = i + 1;
+      while (end < query.size()) {
+        if (query[end] == '\'' && (end + 1 == query.size() || query[end + 1] != '\'')) {
+          break;
+        }
+        end += query[end] == '\'' ? 2 : 1; // A quote is escaped by doubling it
+      }
+      tokens.push_back(query.substr(i, end + 1 - i));
+      i = end + 1;
+    } else if (isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '.' || c == '"') {
+      std::string identifier;
+      while (i < query.size() &&
+             (isalnum(static_cast<unsigned char>(query[i])) || query[i] == '_' || query[i] == '.' || query[i] == '"')) {
+        if (query[i] != '"') {
+          identifier.push_back(static_cast<char>(tolower(static_cast<unsigned char>(query[i]))));
+        }
+        i++;
+      }
+      tokens.push_back(identifier);
+    } else if ((c == '<' || c == '>' || c == '!') && i + 1 < query.size() && query[i + 1] == '=') {
+      tokens.push_back(query.substr(i, 2));
+      i += 2;
+    } else {
+      tokens.push_back(std::string(1, c));
+      i++;
+    }
+  }
+  return tokens;
+}
+
+static size_t find_token(const std::vector<std::string>& tokens, const char* token, size_t start = 0) {
+  for (size_t i = start; i < tokens.size(); ++i) {
+    if (tokens[i] == token) {
+      return i;
+    }
+  }
+  return tokens.size();
+}
+
+static int type_code(const std::string& type) {
+  static const struct { const char* name; int code; } TYPES[] = {
+    { "ascii", TYPE_ASCII }, { "bigint", TYPE_BIGINT }, { "blob", TYPE_BLOB },
+    { "boolean", TYPE_BOOLEAN }, { "counter", TYPE_COUNTER }, { "decimal", TYPE_DECIMAL },
+    { "double", TYPE_DOUBLE }, { "float", TYPE_FLOAT }, { "int", TYPE_INT },
+    { "text", TYPE_VARCHAR }, { "timestamp", TYPE_TIMESTAMP }, { "uuid", TYPE_UUID },
+    { "varchar", TYPE_VARCHAR }, { "varint", TYPE_VARINT }, { "timeuuid", TYPE_TIMEUUID },
+    { "inet", TYPE_INET }, { "date", TYPE_DATE }, { "time", TYPE_TIME },
+    { "smallint", TYPE_SMALLINT }, { "tinyint", TYPE_TINYINT }
+  };
+  for (const auto& entry : TYPES) {
+    if (type == entry.name) {
+      return entry.code;
+    }
+  }
+  return TYPE_BLOB;
+}
+
+// The value every row of a learned table has for a column of the type.
+// Text matches the rows the workloads write.
+static std::string canned_value(int type, int data_size) {
+  switch (type) {
+    case TYPE_ASCII: case TYPE_BLOB: case TYPE_VARCHAR:
+      return bytes_value(std::string(data_size, 'a'));
+    case TYPE_UUID: case TYPE_TIMEUUID:
+      return uuid_value(0x0123456789ab4defULL, 0x8123456789abcdefULL);
+    case TYPE_BIGINT: case TYPE_COUNTER: case TYPE_DOUBLE: case TYPE_TIMESTAMP: case TYPE_TIME:
+      return bytes_value(std::string(8, '\0'));
+    case TYPE_FLOAT: case TYPE_INT: case TYPE_DATE:
+      return bytes_value(std::string(4, '\0'));
+    case TYPE_SMALLINT:
+      return bytes_value(std::string(2, '\0'));
+    case TYPE_BOOLEAN: case TYPE_TINYINT: case TYPE_VARINT:
+      return bytes_value(std::string(1, '\0'));
+    case TYPE_INET:
+      return inet_value("127.0.0.1");
+    default:
+      return bytes_value(std::string());
+  }
+}
+
+MockServer::MockServer(const Config& config)
+  : port_(config.port)
+  , data_size_(config.data_size)
+  , is_running_(false)
+  , is_injecting_(false)
+  , sleeper_due_(0)
+  , is_sleeper_stopping_(false)
+  , latency_type_(LATENCY_NONE)
+  , latency_ns_(0)
+  , latency_sigma_(0.0)
+  , pause_interval_ns_(0)
+  , pause_ns_(0)
+  , start_time_(0)
+  , overloaded_percent_(0.0)
+  , unavailable_percent_(0.0)
+  , read_timeout_percent_(0.0)
+  , disconnect_interval_(config.mock_disconnect_interval)
+  , random_(uv_hrtime()) {
+  // fixed:<us>, lognormal:<median us>:<sigma> or gc:<us>:<interval ms>:<pause ms>
+  if (!config.mock_latency.empty()) {
+    int latency, pause_interval, pause;
+    double sigma;
+    char end;
+    if (sscanf(config.mock_latency.c_str(), "fixed:%d%c", &latency, &end) == 1 && latency >= 0) {
+      latency_type_ = LATENCY_FIXED;
+    } else if (sscanf(config.mock_latency.c_str(), "lognormal:%d:%lf%c", &latency, &sigma, &end) == 2 &&
+               latency > 0 && sigma >= 0.0) {
+      latency_type_ = LATENCY_LOGNORMAL;
+      latency_sigma_ = sigma;
+    } else if (sscanf(config.mock_latency.c_str(), "gc:%d:%d:%d%c", &latency, &pause_interval, &pause, &end) == 3 &&
+               latency >= 0 && pause_interval > 0 && pause > 0 && pause < pause_interval) {
+      latency_type_ = LATENCY_GC;
+      pause_interval_ns_ = static_cast<uint64_t>(pause_interval) * NANOS_PER_MILLI;
+      pause_ns_ = static_cast<uint64_t>(pause) * NANOS_PER_MILLI;
+    } else {
+      fprintf(stderr, "--mock-latency has the invalid value '%s' (expected fixed:<us>, "
+                      "lognormal:<median us>:<sigma> or gc:<us>:<interval ms>:<pause ms>)\n",
+              config.mock_latency.c_str());
+      exit(-1);
+    }
+    latency_ns_ = static_cast<uint64_t>(latency) * 1000;
+  }
+
+  // <error>=<percent of the requests>,...
+  std::stringstream errors(config.mock_errors);
+  std::string item;
+  while (std::getline(errors, item, ',')) {
+    size_t pos = item.find('=');
+    double percent = pos != std::string::npos ? atof(item.c_str() + pos + 1) : -1.0;
+    std::string error(item.substr(0, pos));
+    if (percent < 0.0 || percent > 100.0) {
+      fprintf(stderr, "--mock-errors has an invalid percentage for '%s'\n", error.c_str());
+      exit(-1);
+    }
+    if (error == "overloaded") {
+      overloaded_percent_ = percent;
+    } else if (error == "unavailable") {
+      unavailable_percent_ = percent;
+    } else if (error == "read_timeout") {
+      read_timeout_percent_ = percent;
+    } else {
+      fprintf(stderr, "--mock-errors has the invalid error '%s' "
+                      "(expected overloaded, unavailable or read_timeout)\n", error.c_str());
+      exit(-1);
+    }
+  }
+  if (overloaded_percent_ + unavailable_percent_ + read_timeout_percent_ > 100.0) {
+    fprintf(stderr, "--mock-errors adds up to more than 100 percent\n");
+    exit(-1);
+  }
+
+  encode_short(&supported_, 2);
+  encode_string(&supported_, "COMPRESSION");
+  encode_short(&supported_, 0);
+  encode_string(&supported_, "CQL_VERSION");
+  encode_short(&supported_, 1);
+  encode_string(&supported_, CQL_VERSION);
+
+  encode_int(&void_result_, RESULT_VOID);
+
+  // The errors claim the one replica a consistency of ONE needs is down or
+  // didn't answer in time
+  overloaded_error_ = error_body(ERROR_OVERLOADED, "Server is overloaded");
+  unavailable_error_ = error_body(ERROR_UNAVAILABLE, "Cannot achieve consistency level ONE");
+  encode_short(&unavailable_error_, CONSISTENCY_ONE);
+  encode_int(&unavailable_error_, 1); // Required
+  encode_int(&unavailable_error_, 0); // Alive
+  read_timeout_error_ = error_body(ERROR_READ_TIMEOUT, "Operation timed out - received only 0 responses.");
+  encode_short(&read_timeout_error_, CONSISTENCY_ONE);
+  encode_int(&read_timeout_error_, 0); // Received
+  encode_int(&read_timeout_error_, 1); // Block for
+  encode_byte(&read_timeout_error_, 0); // Data present
+
+  // Every node owns an even share of the ring
+  for (int i = 0; i < config.mock_server_nodes; ++i) {
+    std::unique_ptr<Node> node(new Node());
+    char address[32];
+    snprintf(address, sizeof(address), "127.0.0.%d", i + 1);
+    node->server = this;
+    node->address = address;
+    node->token = static_cast<int64_t>(static_cast<uint64_t>(INT64_MIN) +
+                                       (i + 1) * (UINT64_MAX / config.mock_server_nodes));
+    node->pause_offset = i * pause_interval_ns_ / config.mock_server_nodes;
+    nodes_.push_back(std::move(node));
+  }
+  for (auto& node : nodes_) {
+    add_system_tables(node.get());
+  }
+}
+
+MockServer::~MockServer() {
+  stop();
+}
+
+bool MockServer::start() {
+  uv_loop_init(&loop_);
+
+  int rc = 0;
+  for (auto& node : nodes_) {
+    uv_tcp_init(&loop_, &node->listener);
+    node->listener.data = node.get();
+    if (rc != 0) {
+      continue;
+    }
+
+    // Linux routes all of 127.0.0.0/8 to the loopback interface, other
+    // platforms need an alias for each node after the first
+    struct sockaddr_in addr;
+    uv_ip4_addr(node->address.c_str(), port_, &addr);
+    rc = uv_tcp_bind(&node->listener, reinterpret_cast<const struct sockaddr*>(&addr), 0);
+    if (rc == 0) {
+      rc = uv_listen(reinterpret_cast<uv_stream_t*>(&node->listener), 128, on_connection);
+    }
+    if (rc != 0) {
+      fprintf(stderr, "Mock server unable to listen on %s:%d: %s\n",
+              node->address.c_str(), port_, uv_strerror(rc));
+    }
+  }
+
+  if (rc != 0) {
+    for (auto& node : nodes_) {
+      uv_close(reinterpret_cast<uv_handle_t*>(&node->listener), NULL);
+    }
+    uv_run(&loop_, UV_RUN_DEFAULT);
+    uv_loop_close(&loop_);
+    return false;
+  }
+
+  uv_async_init(&loop_, &stop_async_, on_stop);
+  stop_async_.data = this;
+  uv_async_init(&loop_, &delay_async_, on_delay);
+  uv_timer_init(&loop_, &disconnect_timer_);
+  disconnect_timer_.data = this;
+  if (disconnect_interval_ > 0) {
+    uv_timer_start(&disconnect_timer_, on_disconnect, disconnect_interval_, disconnect_interval_);
+  }
+  start_time_ = uv_hrtime();
+  uv_mutex_init(&sleeper_mutex_);
+  uv_cond_init(&sleeper_cond_);
+  sleeper_due_ = 0;
+  is_sleeper_stopping_ = false;
+  uv_thread_create(&sleeper_thread_, run_sleeper, this);
+  uv_thread_create(&thread_, run, this);
+  is_running_ = true;
+  return true;
+}
+
+void MockServer::stop() {
+  if (!is_running_) {
+    return;
+  }
+  // The sleeper stops first so it never wakes up a closed loop
+  uv_mutex_lock(&sleeper_mutex_);
+  is_sleeper_stopping_ = true;
+  uv_cond_signal(&sleeper_cond_);
+  uv_mutex_unlock(&sleeper_mutex_);
+  uv_thread_join(&sleeper_thread_);
+  uv_cond_destroy(&sleeper_cond_);
+  uv_mutex_destroy(&sleeper_mutex_);
+
+  uv_async_send(&stop_async_);
+  uv_thread_join(&thread_);
+  uv_loop_close(&loop_);
+  is_running_ = false;
+}
+
+void MockServer::start_workloads() {
+  for (auto& node : nodes_) {
+    node->num_requests.store(0, std::memory_order_relaxed);
+    node->num_routable.store(0, std::memory_order_relaxed);
+    node->num_on_replica.store(0, std::memory_order_relaxed);
+    node->num_errors.store(0, std::memory_order_relaxed);
+    node->num_disconnects.store(0, std::memory_order_relaxed);
+  }
+  is_injecting_.store(true);
+}
+
+void MockServer::pause_workloads() {
+  is_injecting_.store(false);
+}
+
+void MockServer::resume_workloads() {
+  is_injecting_.store(true);
+}
+
+void MockServer::run(void* arg) {
+  MockServer* server = static_cast<MockServer*>(arg);
+
+  for (;;) {
+    uint64_t due = server->write_delayed();
+    if (due > 0) {
+      server->wake_at(due);
+    }
+    if (uv_run(&server->loop_, UV_RUN_ONCE) == 0) {
+      break;
+    }
+  }
+}
+
+void MockServer::run_sleeper(void* arg) {
+  MockServer* server = static_cast<MockServer*>(arg);
+#ifdef __linux__
+  // Timed waits are otherwise allowed to run 50 microseconds late
+  prctl(PR_SET_TIMERSLACK, 1UL, 0, 0, 0);
+#endif
+
+  uv_mutex_lock(&server->sleeper_mutex_);
+  while (!server->is_sleeper_stopping_) {
+    if (server->sleeper_due_ == 0) {
+      uv_cond_wait(&server->sleeper_cond_, &server->sleeper_mutex_);
+      continue;
+    }
+    uint64_t now = uv_hrtime();
+    if (now >= server->sleeper_due_) {
+      server->sleeper_due_ = 0;
+      uv_async_send(&server->delay_async_);
+    } else {
+      uv_cond_timedwait(&server->sleeper_cond_, &server->sleeper_mutex_, server->sleeper_due_ - now);
+    }
+  }
+  uv_mutex_unlock(&server->sleeper_mutex_);
+}
+
+void MockServer::wake_at(uint64_t due) {
+  // A later time than the one the sleeper already waits for is picked up
+  // once the loop wakes up for that one
+  uv_mutex_lock(&sleeper_mutex_);
+  if (sleeper_due_ == 0 || due < sleeper_due_) {
+    sleeper_due_ = due;
+    uv_cond_signal(&sleeper_cond_);
+  }
+  uv_mutex_unlock(&sleeper_mutex_);
+}
+
+void MockServer::on_delay(uv_async_t* async) {
+  // Only wakes up the loop
+}
+
+void MockServer::on_disconnect(uv_timer_t* timer) {
+  MockServer* server = static_cast<MockServer*>(timer->data);
+  if (!server->is_injecting_.load(std::memory_order_relaxed) || server->connections_.empty()) {
+    return;
+  }
+  auto it = server->connections_.begin();
+  std::advance(it, server->random_.next(server->connections_.size()));
+  Connection* connection = *it;
+  connection->node->num_disconnects.fetch_add(1, std::memory_order_relaxed);
+  server->close(connection);
+}
+
+void MockServer::on_stop(uv_async_t* async) {
+  MockServer* server = static_cast<MockServer*>(async->data);
+  while (!server->delayed_.empty()) {
+    Connection* connection = server->delayed_.top().connection;
+    server->delayed_.pop();
+    if (--connection->num_delayed == 0 && connection->is_closed) {
+      delete connection;
+    }
+  }
+  std::vector<Connection*> connections(server->connections_.begin(), server->connections_.end());
+  for (auto connection : connections) {
+    server->close(connection);
+  }
+  for (auto& node : server->nodes_) {
+    uv_close(reinterpret_cast<uv_handle_t*>(&node->listener), NULL);
+  }
+  uv_close(reinterpret_cast<uv_handle_t*>(&server->delay_async_), NULL);
+  uv_close(reinterpret_cast<uv_handle_t*>(&server->disconnect_timer_), NULL);
+  uv_close(reinterpret_cast<uv_handle_t*>(async), NULL);
+}
+
+void MockServer::on_connection(uv_stream_t* stream, int status) {
+  if (status != 0) {
+    return;
+  }
+
+  Node* node = static_cast<Node*>(stream->data);
+  MockServer* server = node->server;
+  Connection* connection = new Connection(node);
+  uv_tcp_init(&server->loop_, &connection->tcp);
+  if (uv_accept(stream, reinterpret_cast<uv_stream_t*>(&connection->tcp)) != 0) {
+    uv_close(reinterpret_cast<uv_handle_t*>(&connection->tcp), on_close);
+    return;
+  }
+
+  uv_tcp_nodelay(&connection->tcp, 1);
+  server->connections_.insert(connection);
+  uv_read_start(reinterpret_cast<uv_stream_t*>(&connection->tcp), on_alloc, on_read);
+}
+
+void MockServer::on_alloc(uv_handle_t* handle, size_t suggested_size, uv_buf_t* buf) {
+  Connection* connection = static_cast<Connection*>(handle->data);
+  *buf = uv_buf_init(connection->buffer, READ_BUFFER_SIZE);
+}
+
+void MockServer::on_read(uv_stream_t* stream, ssize_t nread, const uv_buf_t* buf) {
+  Connection* connection = static_cast<Connection*>(stream->data);
+  MockServer* server = connection->server;
+  if (nread < 0) {
+    server->close(connection);
+    return;
+  }
+
+  connection->input.append(buf->base, nread);
+
+  Write* write = new Write();
+  ssize_t consumed = server->process(connection, write);
+  if (consumed < 0) {
+    delete write;
+    server->close(connection);
+    return;
+  }
+  connection->input.erase(0, consumed);
+
+  server->write(connection, write);
+}
+
+void MockServer::on_write(uv_write_t* req, int status) {
+  delete static_cast<Write*>(req->data);
+}
+
+void MockServer::on_close(uv_handle_t* handle) {
+  Connection* connection = static_cast<Connection*>(handle->data);
+  connection->is_closed = true;
+  if (connection->num_delayed == 0) {
+    delete connection;
+  }
+}
+
+void MockServer::close(Connection* connection) {
+  if (connections_.erase(connection) > 0) {
+    connection->is_closing = true;
+    uv_close(reinterpret_cast<uv_handle_t*>(&connection->tcp), on_close);
+  }
+}
+
+// Writes the responses' headers and bodies in one go, takes ownership of the write
+void MockServer::write(Connection* connection, Write* write) {
+  if (write->responses.empty()) {
+    delete write;
+    return;
+  }
+
+  for (const auto& response : write->responses) {
+    write->bufs.push_back(uv_buf_init(const_cast<char*>(write->headers.data() + response.header_offset),
+                                      response.header_size));
+    if (response.body && !response.body->empty()) {
+      write->bufs.push_back(uv_buf_init(const_cast<char*>(response.body->data()),
+                                        response.body->size()));
+    }
+  }
+
+  if (uv_write(&write->req, reinterpret_cast<uv_stream_t*>(&connection->tcp),
+               write->bufs.data(), write->bufs.size(), on_write) != 0) {
+    delete write;
+    close(connection);
+  }
+}
+
+void MockServer::add_workload_response(Connection* connection, Write* write, int version, int stream,
+                                       int opcode, const std::string* body) {
+  if (!is_injecting_.load(std::memory_order_relaxed)) {
+    add_response(write, version, stream, opcode, body);
+    return;
+  }
+
+  const std::string* error = next_error();
+  if (error) {
+    connection->node->num_errors.fetch_add(1, std::memory_order_relaxed);
+    opcode = OPCODE_ERROR;
+    body = error;
+  }
+
+  if (latency_type_ == LATENCY_NONE) {
+    add_response(write, version, stream, opcode, body);
+    return;
+  }
+
+  Delayed delayed;
+  delayed.due = due_time(connection->node, uv_hrtime());
+  delayed.connection = connection;
+  delayed.version = version;
+  delayed.stream = stream;
+  delayed.opcode = opcode;
+  delayed.body = body;
+  delayed_.push(delayed);
+  connection->num_delayed++;
+}
+
+uint64_t MockServer::write_delayed() {
+  // The responses due at the same time on a connection share a write
+  std::unordered_map<Connection*, Write*> writes;
+  uint64_t now = uv_hrtime();
+  while (!delayed_.empty() && delayed_.top().due <= now) {
+    Delayed delayed = delayed_.top();
+    delayed_.pop();
+
+    Connection* connection = delayed.connection;
+    connection->num_delayed--;
+    if (connection->is_closing) {
+      if (connection->is_closed && connection->num_delayed == 0) {
+        delete connection;
+      }
+      continue;
+    }
+
+    Write*& write = writes[connection];
+    if (!write) {
+      write = new Write();
+    }
+    add_response(write, delayed.version, delayed.stream, delayed.opcode, delayed.body);
+  }
+
+  for (const auto& pair : writes) {
+    if (!pair.first->is_closing) {
+      this->write(pair.first, pair.second);
+    } else {
+      delete pair.second;
+    }
+  }
+
+  return delayed_.empty() ? 0 : delayed_.top().due;
+}
+
+uint64_t MockServer::due_time(const Node* node, uint64_t now) {
+  uint64_t due = now + latency_ns_;
+  if (latency_type_ == LATENCY_LOGNORMAL) {
+    // Box-Muller gives a standard normal sample
+    double u1 = 1.0 - random_.next_double();
+    double u2 = random_.next_double();
+    double normal = std::sqrt(-2.0 * std::log(u1)) * std::cos(TWO_PI * u2);
+    due = now + static_cast<uint64_t>(latency_ns_ * std::exp(latency_sigma_ * normal));
+  } else if (latency_type_ == LATENCY_GC) {
+    // Every node stops the world for a while once per interval and answers
+    // the requests that arrived during the pause after it
+    uint64_t phase = (due - start_time_ + node->pause_offset) % pause_interval_ns_;
+    if (phase < pause_ns_) {
+      due += pause_ns_ - phase;
+    }
+  }
+  return due;
+}
+
+const std::string* MockServer::next_error() {
+  double percent = 100.0 * random_.next_double();
+  if (percent < overloaded_percent_) {
+    return &overloaded_error_;
+  }
+  percent -= overloaded_percent_;
+  if (percent < unavailable_percent_) {
+    return &unavailable_error_;
+  }
+  percent -= unavailable_percent_;
+  if (percent < read_timeout_percent_) {
+    return &read_timeout_error_;
+  }
+  return NULL;
+}
+
+// Adds a response frame, protocol v1 and v2 have a single byte stream id
+void MockServer::add_response(Write* write, int version, int stream, int opcode, const std::string* body) {
+  Write::Response response;
+  response.header_offset = write->headers.size();
+  response.body = body;
+
+  encode_byte(&write->headers, 0x80 | version);
+  encode_byte(&write->headers, 0);
+  if (version >= 3) {
+    encode_short(&write->headers, stream);
+  } else {
+    encode_byte(&write->headers, stream);
+  }
+  encode_byte(&write->headers, opcode);
+  encode_int(&write->headers, body ? static_cast<int32_t>(body->size()) : 0);
+
+  response.header_size = write->headers.size() - response.header_offset;
+  write->responses.push_back(response);
+}
+
+ssize_t MockServer::process(Connection* connection, Write* write) {
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(connection->input.data());
+  size_t size = connection->input.size();
+  size_t pos = 0;
+
+  while (pos < size) {
+    const uint8_t* header = data + pos;
+    int version = header[0] & 0x7F;
+    size_t header_size = version >= 3 ? 9 : 8;
+    if (size - pos < header_size) {
+      break;
+    }
+
+    int stream = version >= 3 ? (header[2] << 8) | header[3] : header[2];
+    int opcode = header[header_size - 5];
+    uint32_t length = (static_cast<uint32_t>(header[header_size - 4]) << 24) |
+                      (header[header_size - 3] << 16) | (header[header_size - 2] << 8) |
+                      header[header_size - 1];
+    if (length > MAX_FRAME_LENGTH) {
+      return -1;
+    }
+    if (size - pos - header_size < length) {
+      break;
+    }
+
+    Decoder decoder(reinterpret_cast<const char*>(header + header_size), length);
+    pos += header_size + length;
+
+    // The driver lowers its version until it finds one that's supported
+    if (version < MIN_PROTOCOL_VERSION || version > MAX_PROTOCOL_VERSION) {
+      char message[128];
+      snprintf(message, sizeof(message),
+               "Invalid or unsupported protocol version (%d); supported versions are (3/v3, 4/v4)",
+               version);
+      write->bodies.push_back(error_body(ERROR_PROTOCOL, message));
+      add_response(write, std::min(version, MAX_PROTOCOL_VERSION), stream, OPCODE_ERROR,
+                   &write->bodies.back());
+      continue;
+    }
+
+    switch (opcode) {
+      case OPCODE_STARTUP:
+      case OPCODE_REGISTER:
+        add_response(write, version, stream, OPCODE_READY, NULL);
+        break;
+      case OPCODE_OPTIONS:
+        add_response(write, version, stream, OPCODE_SUPPORTED, &supported_);
+        break;
+      case OPCODE_QUERY: {
+        std::string query;
+        if (!decoder.decode_long_string(&query)) {
+          return -1;
+        }
+        const Statement& statement = this->statement(connection->node, query, write);
+        if (statement.is_system) {
+          add_response(write, version, stream, statement.opcode, &statement.result);
+        } else {
+          count(connection->node, statement, decoder.position(), decoder.remaining(), 0);
+          add_workload_response(connection, write, version, stream, statement.opcode, &statement.result);
+        }
+        break;
+      }
+      case OPCODE_PREPARE: {
+        std::string query;
+        if (!decoder.decode_long_string(&query)) {
+          return -1;
+        }
+        const Statement& statement = this->statement(connection->node, query, NULL);
+        add_response(write, version, stream, statement.opcode,
+                     &statement.prepared[version - MIN_PROTOCOL_VERSION]);
+        break;
+      }
+      case OPCODE_EXECUTE: {
+        std::string id;
+        int consistency, flags;
+        if (!decoder.decode_short_bytes(&id) || !decoder.decode_short(&consistency) ||
+            !decoder.decode_byte(&flags)) {
+          return -1;
+        }
+        auto it = connection->node->prepared.find(id);
+        if (it == connection->node->prepared.end()) {
+          std::string body(error_body(ERROR_UNPREPARED, "Prepared query with ID not found"));
+          encode_short(&body, static_cast<int>(id.size()));
+          body.append(id);
+          write->bodies.push_back(body);
+          add_response(write, version, stream, OPCODE_ERROR, &write->bodies.back());
+        } else {
+          const Statement& statement = *it->second;
+          count(connection->node, statement, decoder.position(), decoder.remaining(), flags);
+          add_workload_response(connection, write, version, stream, statement.opcode,
+                                (flags & QUERY_FLAG_SKIP_METADATA) ? &statement.result_without_metadata
+                                                                   : &statement.result);
+        }
+        break;
+      }
+      case OPCODE_BATCH: {
+        // Batches are routed by their first statement with a partition key
+        int type, num_statements, kind = 0;
+        const Statement* routed = NULL;
+        const char* values = NULL;
+        size_t values_size = 0;
+        if (!decoder.decode_byte(&type) || !decoder.decode_short(&num_statements)) {
+          return -1;
+        }
+        for (int i = 0; i < num_statements && !routed; ++i) {
+          std::string query_or_id;
+          int num_values;
+          if (!decoder.decode_byte(&kind) ||
+              !(kind == BATCH_KIND_PREPARED ? decoder.decode_short_bytes(&query_or_id)
+                                            : decoder.decode_long_string(&query_or_id))) {
+            return -1;
+          }
+          if (kind == BATCH_KIND_PREPARED) {
+            auto it = connection->node->prepared.find(query_or_id);
+            if (it != connection->node->prepared.end() && !it->second->partition_key_indices.empty()) {
+              routed = it->second;
+              values = decoder.position();
+              values_size = decoder.remaining();
+            }
+          }
+          if (!decoder.decode_short(&num_values)) {
+            return -1;
+          }
+          for (int j = 0; j < num_values; ++j) {
+            const char* value;
+            int32_t value_size;
+            if (!decoder.decode_value(&value, &value_size)) {
+              return -1;
+            }
+          }
+        }
+        if (routed) {
+          count(connection->node, *routed, values, values_size, QUERY_FLAG_VALUES);
+        } else if (is_injecting_.load(std::memory_order_relaxed)) {
+          connection->node->num_requests.fetch_add(1, std::memory_order_relaxed);
+        }
+        add_workload_response(connection, write, version, stream, OPCODE_RESULT, &void_result_);
+        break;
+      }
+      default:
+        write->bodies.push_back(error_body(ERROR_PROTOCOL, "Unsupported opcode"));
+        add_response(write, version, stream, OPCODE_ERROR, &write->bodies.back());
+        break;
+    }
+  }
+
+  return static_cast<ssize_t>(pos);
+}
+
+const MockServer::Statement& MockServer::statement(Node* node, const std::string& query, Write* write) {
+  auto it = node->statements.find(query);
+  if (it != node->statements.end()) {
+    return it->second;
+  }
+
+  Statement statement(build_statement(node, query));
+  if (statement.is_system && write) {
+    write->statements.push_back(statement);
+    return write->statements.back();
+  }
+
+  it = node->statements.insert(std::make_pair(query, statement)).first;
+  if (it->second.opcode == OPCODE_RESULT) {
+    node->prepared[it->second.id] = &it->second;
+  }
+  return it->second;
+}
+
+// Cassandra's Murmur3Partitioner token, the first half of MurmurHash3's
+// x64 128-bit variant. Like Cassandra the tail bytes are sign extended.
+static int64_t murmur3_token(const char* data, size_t size) {
+  const uint64_t c1 = 0x87c37b91114253d5ULL;
+  const uint64_t c2 = 0x4cf5ad432745937fULL;
+  uint64_t h1 = 0, h2 = 0;
+
+  auto rotl = [](uint64_t x, int r) { return (x << r) | (x >> (64 - r)); };
+  auto fmix = [](uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return k;
+  };
+  auto block = [data](size_t i) {
+    uint64_t value = 0;
+    for (int b = 7; b >= 0; --b) {
+      value = (value << 8) | static_cast<uint8_t>(data[i * 8 + b]);
+    }
+    return value;
+  };
+  auto tail = [data](size_t i) { return static_cast<uint64_t>(static_cast<int64_t>(static_cast<int8_t>(data[i]))); };
+
+  size_t num_blocks = size / 16;
+  for (size_t i = 0; i < num_blocks; ++i) {
+    uint64_t k1 = block(i * 2), k2 = block(i * 2 + 1);
+    k1 *= c1; k1 = rotl(k1, 31); k1 *= c2; h1 ^= k1;
+    h1 = rotl(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+    k2 *= c2; k2 = rotl(k2, 33); k2 *= c1; h2 ^= k2;
+    h2 = rotl(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+  }
+
+  size_t offset = num_blocks * 16;
+  uint64_t k1 = 0, k2 = 0;
+  switch (size & 15) {
+    case 15: k2 ^= tail(offset + 14) << 48;
+    case 14: k2 ^= tail(offset + 13) << 40;
+    case 13: k2 ^= tail(offset + 12) << 32;
+    case 12: k2 ^= tail(offset + 11) << 24;
+    case 11: k2 ^= tail(offset + 10) << 16;
+    case 10: k2 ^= tail(offset + 9) << 8;
+    case 9: k2 ^= tail(offset + 8);
+      k2 *= c2; k2 = rotl(k2, 33); k2 *= c1; h2 ^= k2;
+    case 8: k1 ^= tail(offset + 7) << 56;
+    case 7: k1 ^= tail(offset + 6) << 48;
+    case 6: k1 ^= tail(offset + 5) << 40;
+    case 5: k1 ^= tail(offset + 4) << 32;
+    case 4: k1 ^= tail(offset + 3) << 24;
+    case 3: k1 ^= tail(offset + 2) << 16;
+    case 2: k1 ^= tail(offset + 1) << 8;
+    case 1: k1 ^= tail(offset);
+      k1 *= c1; k1 = rotl(k1, 31); k1 *= c2; h1 ^= k1;
+  }
+
+  h1 ^= size;
+  h2 ^= size;
+  h1 += h2;
+  h2 += h1;
+  h1 = fmix(h1);
+  h2 = fmix(h2);
+  h1 += h2;
+
+  int64_t token = static_cast<int64_t>(h1);
+  return token == INT64_MIN ? INT64_MAX : token;
+}
+
+void MockServer::count(Node* node, const Statement& statement, const char* values, size_t size, int flags) {
+  if (!is_injecting_.load(std::memory_order_relaxed)) {
+    return;
+  }
+  node->num_requests.fetch_add(1, std::memory_order_relaxed);
+  if (statement.partition_key_indices.empty() || !(flags & QUERY_FLAG_VALUES)) {
+    return;
+  }
+  node->num_routable.fetch_add(1, std::memory_order_relaxed);
+
+  // A single node owns every token, there's no need to hash
+  if (nodes_.size() == 1) {
+    node->num_on_replica.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  // The routing key is the partition key's value, or for a composite key
+  // each component's size, bytes and a zero byte
+  Decoder decoder(values, size);
+  int num_values;
+  if (!decoder.decode_short(&num_values)) {
+    return;
+  }
+  std::vector<std::pair<const char*, int32_t> > components(statement.partition_key_indices.size());
+  for (int i = 0; i < num_values; ++i) {
+    int name_size;
+    const char* value;
+    int32_t value_size;
+    if (((flags & QUERY_FLAG_NAMES_FOR_VALUES) && (!decoder.decode_short(&name_size) || !decoder.skip(name_size))) ||
+        !decoder.decode_value(&value, &value_size)) {
+      return;
+    }
+    for (size_t c = 0; c < components.size(); ++c) {
+      if (statement.partition_key_indices[c] == i) {
+        components[c] = std::make_pair(value, std::max(value_size, 0));
+      }
+    }
+  }
+
+  int64_t token;
+  if (components.size() == 1) {
+    token = murmur3_token(components[0].first, components[0].second);
+  } else {
+    std::string routing_key;
+    for (const auto& component : components) {
+      encode_short(&routing_key, component.second);
+      routing_key.append(component.first ? component.first : "", component.second);
+      encode_byte(&routing_key, 0);
+    }
+    token = murmur3_token(routing_key.data(), routing_key.size());
+  }
+
+  if (is_replica(node, token, statement.replication_factor)) {
+    node->num_on_replica.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+// Like SimpleStrategy the replicas are the token's owner and the nodes that
+// follow it around the ring
+bool MockServer::is_replica(const Node* node, int64_t token, int replication_factor) const {
+  size_t owner = 0;
+  while (owner < nodes_.size() && nodes_[owner]->token < token) {
+    owner++;
+  }
+  for (int i = 0; i < replication_factor && i < static_cast<int>(nodes_.size()); ++i) {
+    if (nodes_[(owner + i) % nodes_.size()].get() == node) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void MockServer::print_counts(FILE* file) const {
+  int64_t total_requests = 0;
+  int64_t total_routable = 0;
+  int64_t total_on_replica = 0;
+  int64_t total_errors = 0;
+  int64_t total_disconnects = 0;
+  for (const auto& node : nodes_) {
+    total_requests += node->num_requests.load(std::memory_order_relaxed);
+    total_routable += node->num_routable.load(std::memory_order_relaxed);
+    total_on_replica += node->num_on_replica.load(std::memory_order_relaxed);
+  }
+
+  // The share of the requests each node coordinated and the fraction of the
+  // routable ones it was a replica for
+  fprintf(file,
+          "\ncoordinators\n"
+          "%12s, %20s, %12s, %8s, %12s, %12s, %10s, %10s, %11s\n",
+          "node", "token", "requests", "share", "routable", "on_replica", "replica %",
+          "errors", "disconnects");
+  for (const auto& node : nodes_) {
+    int64_t num_requests = node->num_requests.load(std::memory_order_relaxed);
+    int64_t num_routable = node->num_routable.load(std::memory_order_relaxed);
+    int64_t num_on_replica = node->num_on_replica.load(std::memory_order_relaxed);
+    int64_t num_errors = node->num_errors.load(std::memory_order_relaxed);
+    int64_t num_disconnects = node->num_disconnects.load(std::memory_order_relaxed);
+    fprintf(file, "%12s, %20lld, %12lld, %8.2f, %12lld, %12lld, %10.2f, %10lld, %11lld\n",
+            node->address.c_str(), static_cast<long long>(node->token),
+            static_cast<long long>(num_requests),
+            total_requests > 0 ? 100.0 * num_requests / total_requests : 0.0,
+            static_cast<long long>(num_routable), static_cast<long long>(num_on_replica),
+            num_routable > 0 ? 100.0 * num_on_replica / num_routable : 0.0,
+            static_cast<long long>(num_errors), static_cast<long long>(num_disconnects));
+    total_errors += num_errors;
+    total_disconnects += num_disconnects;
+  }
+  fprintf(file, "%12s, %20s, %12lld, %8.2f, %12lld, %12lld, %10.2f, %10lld, %11lld\n",
+          "all", "", static_cast<long long>(total_requests), total_requests > 0 ? 100.0 : 0.0,
+          static_cast<long long>(total_routable), static_cast<long long>(total_on_replica),
+          total_routable > 0 ? 100.0 * total_on_replica / total_routable : 0.0,
+          static_cast<long long>(total_errors), static_cast<long long>(total_disconnects));
+}
+
+// The column of a bind marker is the one it's compared to
+static std::string variable_name(const std::vector<std::string>& tokens, size_t i) {
+  if (i >= 1 && tokens[i - 1] == "limit") {
+    return "[limit]";
+  }
+  if (i >= 2 && (tokens[i - 1] == "=" || tokens[i - 1] == "<" || tokens[i - 1] == ">" ||
+                 tokens[i - 1] == "<=" || tokens[i - 1] == ">=" || tokens[i - 1] == "in")) {
+    return tokens[i - 2];
+  }
+  return "";
+}
+
+void MockServer::encode_metadata(std::string* body, const std::string& keyspace, const std::string& table,
+                                 const std::vector<Column>& columns) {
+  if (columns.empty()) {
+    encode_int(body, METADATA_NO_METADATA);
+    encode_int(body, 0);
+    return;
+  }
+  encode_int(body, METADATA_GLOBAL_TABLES_SPEC);
+  encode_int(body, static_cast<int32_t>(columns.size()));
+  encode_string(body, keyspace);
+  encode_string(body, table);
+  for (const auto& column : columns) {
+    encode_string(body, column.name);
+    body->append(column.type);
+  }
+}
+
+MockServer::Statement MockServer::build_statement(const Node* node, const std::string& query) {
+  std::vector<std::string> tokens(tokenize(query));
+  std::string verb(tokens.empty() ? "" : tokens[0]);
+
+  Statement statement;
+  statement.id = statement_id(query);
+  statement.opcode = OPCODE_RESULT;
+
+  // Find the table and the column of every bind marker
+  std::string table_name;
+  std::vector<std::string> selected;
+  std::vector<std::string> variables;
+  if (verb == "select" || verb == "delete") {
+    size_t from = find_token(tokens, "from");
+    if (from + 1 < tokens.size()) {
+      table_name = tokens[from + 1];
+    }
+    for (size_t i = 1; verb == "select" && i < from; ++i) {
+      if (tokens[i] != "," && tokens[i] != "*") {
+        selected.push_back(tokens[i]);
+      }
+    }
+  } else if (verb == "insert" && tokens.size() > 2) {
+    table_name = tokens[2];
+    size_t columns_start = find_token(tokens, "(");
+    size_t values_start = find_token(tokens, "(", find_token(tokens, "values"));
+    std::vector<std::string> columns;
+    for (size_t i = columns_start + 1; i < tokens.size() && tokens[i] != ")"; ++i) {
+      if (tokens[i] != ",") {
+        columns.push_back(tokens[i]);
+      }
+    }
+    size_t index = 0;
+    for (size_t i = values_start + 1; i < tokens.size() && tokens[i] != ")"; ++i) {
+      if (tokens[i] == ",") {
+        index++;
+      } else if (tokens[i] == "?") {
+        variables.push_back(index < columns.size() ? columns[index] : "");
+      }
+    }
+  } else if (verb == "update" && tokens.size() > 1) {
+    table_name = tokens[1];
+  } else if (verb == "create" && tokens.size() > 1 && tokens[1] == "table") {
+    Table table;
+    if (parse_table(tokens, data_size_, &table)) {
+      add_table(table);
+    }
+  } else if (verb == "create" && tokens.size() > 1 && tokens[1] == "keyspace") {
+    add_keyspace(tokens);
+  }
+
+  if (verb != "insert") {
+    for (size_t i = 0; i < tokens.size(); ++i) {
+      if (tokens[i] == "?") {
+        variables.push_back(variable_name(tokens, i));
+      }
+    }
+  }
+
+  std::string keyspace(table_name.substr(0, table_name.find('.')));
+  std::string name(table_name.find('.') != std::string::npos ? table_name.substr(table_name.find('.') + 1) : "");
+  const Table* table = find_table(node, table_name);
+  statement.is_system = keyspace.compare(0, 6, "system") == 0;
+  auto replication_factor = replication_factors_.find(keyspace);
+  if (replication_factor != replication_factors_.end()) {
+    statement.replication_factor = replication_factor->second;
+  }
+
+  // Project the selected columns of a known table
+  std::vector<size_t> projection;
+  std::vector<Column> result_columns;
+  if (verb == "select" && table) {
+    if (selected.empty()) {
+      for (size_t i = 0; i < table->columns.size(); ++i) {
+        projection.push_back(i);
+      }
+    }
+    for (const auto& column_name : selected) {
+      size_t i = 0;
+      while (i < table->columns.size() && table->columns[i].name != column_name) {
+        i++;
+      }
+      if (i == table->columns.size()) {
+        statement.opcode = OPCODE_ERROR;
+        statement.result = error_body(ERROR_INVALID, "Undefined column name " + column_name);
+        statement.result_without_metadata = statement.result;
+        statement.prepared[0] = statement.prepared[1] = statement.result;
+        return statement;
+      }
+      projection.push_back(i);
+    }
+    for (size_t i : projection) {
+      result_columns.push_back(table->columns[i]);
+    }
+  }
+
+  // The result of an execution
+  if (verb == "select") {
+    std::string rows;
+    encode_int(&rows, table ? static_cast<int32_t>(table->rows.size()) : 0);
+    for (size_t i = 0; table && i < table->rows.size(); ++i) {
+      for (size_t column : projection) {
+        rows.append(table->rows[i][column]);
+      }
+    }
+    encode_int(&statement.result, RESULT_ROWS);
+    encode_metadata(&statement.result, keyspace, name, result_columns);
+    statement.result.append(rows);
+
+    encode_int(&statement.result_without_metadata, RESULT_ROWS);
+    encode_int(&statement.result_without_metadata, METADATA_NO_METADATA);
+    encode_int(&statement.result_without_metadata, static_cast<int32_t>(result_columns.size()));
+    statement.result_without_metadata.append(rows);
+  } else if (verb == "use" && tokens.size() > 1) {
+    encode_int(&statement.result, RESULT_SET_KEYSPACE);
+    encode_string(&statement.result, tokens[1]);
+    statement.result_without_metadata = statement.result;
+  } else {
+    statement.result = statement.result_without_metadata = void_result_;
+  }
+
+  // The result of preparing it. The bind markers take the type of their
+  // column and the partition key indices let the driver route by token.
+  std::vector<Column> variable_columns;
+  for (const auto& variable : variables) {
+    std::string type(type_option(variable == "[limit]" ? TYPE_INT : TYPE_BLOB));
+    for (size_t i = 0; table && i < table->columns.size(); ++i) {
+      if (table->columns[i].name == variable) {
+        type = table->columns[i].type;
+      }
+    }
+    variable_columns.push_back(Column(variable, type));
+  }
+
+  std::vector<int> partition_key_indices;
+  for (size_t i = 0; table && i < table->partition_key_count; ++i) {
+    auto variable = std::find(variables.begin(), variables.end(), table->columns[i].name);
+    if (variable == variables.end()) {
+      partition_key_indices.clear();
+      break;
+    }
+    partition_key_indices.push_back(static_cast<int>(variable - variables.begin()));
+  }
+  statement.partition_key_indices = partition_key_indices;
+
+  for (int version = MIN_PROTOCOL_VERSION; version <= MAX_PROTOCOL_VERSION; ++version) {
+    std::string& prepared = statement.prepared[version - MIN_PROTOCOL_VERSION];
+    encode_int(&prepared, RESULT_PREPARED);
+    encode_short(&prepared, static_cast<int>(statement.id.size()));
+    prepared.append(statement.id);
+
+    encode_int(&prepared, variable_columns.empty() ? 0 : METADATA_GLOBAL_TABLES_SPEC);
+    encode_int(&prepared, static_cast<int32_t>(variable_columns.size()));
+    if (version >= 4) {
+      encode_int(&prepared, static_cast<int32_t>(partition_key_indices.size()));
+      for (int index : partition_key_indices) {
+        encode_short(&prepared, index);
+      }
+    }
+    if (!variable_columns.empty()) {
+      encode_string(&prepared, keyspace);
+      encode_string(&prepared, name);
+      for (const auto& column : variable_columns) {
+        encode_string(&prepared, column.name);
+        prepared.append(column.type);
+      }
+    }
+
+    encode_metadata(&prepared, keyspace, name, result_columns);
+  }
+
+  return statement;
+}
+
+// Collections and other parameterized types are kept as blobs
+bool MockServer::parse_table(const std::vector<std::string>& tokens, int data_size, Table* table) {
+  size_t i = 2;
+  if (i < tokens.size() && tokens[i] == "if") {
+    i += 3;
+  }
+  if (i + 1 >= tokens.size() || tokens[i + 1] != "(") {
+    return false;
+  }
+
+  std::string name(tokens[i]);
+  size_t dot = name.find('.');
+  if (dot == std::string::npos) {
+    return false;
+  }
+  table->keyspace = name.substr(0, dot);
+  table->name = name.substr(dot + 1);
+
+  std::vector<Column> columns;
+  std::vector<int> types;
+  std::vector<std::string> partition_key;
+  i += 2;
+  while (i < tokens.size() && tokens[i] != ")") {
+    if (tokens[i] == "primary" && i + 2 < tokens.size() && tokens[i + 2] == "(") {
+      // PRIMARY KEY (pk, ...) or PRIMARY KEY ((pk1, pk2), ...)
+      i += 3;
+      if (tokens[i] == "(") {
+        for (++i; i < tokens.size() && tokens[i] != ")"; ++i) {
+          if (tokens[i] != ",") {
+            partition_key.push_back(tokens[i]);
+          }
+        }
+        i++;
+      } else {
+        partition_key.push_back(tokens[i]);
+      }
+      while (i < tokens.size() && tokens[i] != ")") { // Skip the clustering columns
+        i++;
+      }
+      i++;
+    } else if (i + 1 < tokens.size()) {
+      std::string column(tokens[i]);
+      int type = type_code(tokens[i + 1]);
+      i += 2;
+      if (i < tokens.size() && tokens[i] == "<") {
+        type = TYPE_BLOB;
+        for (int depth = 0; i < tokens.size(); ++i) {
+          depth += tokens[i] == "<" ? 1 : tokens[i] == ">" ? -1 : 0;
+          if (depth == 0) {
+            i++;
+            break;
+          }
+        }
+      }
+      if (i + 1 < tokens.size() && tokens[i] == "primary") {
+        partition_key.push_back(column);
+        i += 2;
+      }
+      columns.push_back(Column(column, type_option(type)));
+      types.push_back(type);
+    }
+    if (i < tokens.size() && tokens[i] == ",") {
+      i++;
+    } else if (i < tokens.size() && tokens[i] != ")") {
+      return false;
+    }
+  }
+
+  // The partition key columns come first like they do for "SELECT *"
+  std::vector<size_t> order;
+  for (const auto& key : partition_key) {
+    for (size_t c = 0; c < columns.size(); ++c) {
+      if (columns[c].name == key) {
+        order.push_back(c);
+      }
+    }
+  }
+  for (size_t c = 0; c < columns.size(); ++c) {
+    if (std::find(partition_key.begin(), partition_key.end(), columns[c].name) == partition_key.end()) {
+      order.push_back(c);
+    }
+  }
+
+  std::vector<std::string> row;
+  for (size_t c : order) {
+    table->columns.push_back(columns[c]);
+    row.push_back(canned_value(types[c], data_size));
+  }
+  table->partition_key_count = partition_key.size();
+  table->rows.push_back(row);
+  return !partition_key.empty();
+}
+
+const MockServer::Table* MockServer::find_table(const Node* node, const std::string& name) const {
+  if (name == "system.local") {
+    return &node->local;
+  } else if (name == "system.peers") {
+    return &node->peers;
+  }
+  auto it = tables_.find(name);
+  return it != tables_.end() ? &it->second : NULL;
+}
+
+void MockServer::add_table(const Table& table) {
+  tables_[table.keyspace + "." + table.name] = table;
+}
+
+// Learns a keyspace's replication from "CREATE KEYSPACE [IF NOT EXISTS] ks
+// WITH replication = {...}" and lists it in system_schema.keyspaces so the
+// driver's token map knows where its replicas are
+void MockServer::add_keyspace(const std::vector<std::string>& tokens) {
+  size_t i = 2;
+  if (i < tokens.size() && tokens[i] == "if") {
+    i += 3;
+  }
+  if (i >= tokens.size() || replication_factors_.count(tokens[i]) > 0) {
+    return;
+  }
+  std::string name(tokens[i]);
+
+  // The options are quoted pairs, NetworkTopologyStrategy has one per data
+  // center and all the mock's nodes are in the same one
+  std::vector<std::pair<std::string, std::string> > replication;
+  int replication_factor = 0;
+  for (i = find_token(tokens, "{", i); i + 2 < tokens.size() && tokens[i] != "}"; i += 4) {
+    std::string key(tokens[i + 1]), value(tokens[i + 3]);
+    key.erase(std::remove(key.begin(), key.end(), '\''), key.end());
+    value.erase(std::remove(value.begin(), value.end(), '\''), value.end());
+    replication.push_back(std::make_pair(key, value));
+    if (key != "class") {
+      replication_factor += atoi(value.c_str());
+    }
+  }
+  replication_factors_[name] = std::max(replication_factor, 1);
+
+  if (tables_.count("system_schema.keyspaces") == 0) {
+    Table keyspaces;
+    keyspaces.keyspace = "system_schema";
+    keyspaces.name = "keyspaces";
+    keyspaces.partition_key_count = 1;
+    keyspaces.columns.push_back(Column("keyspace_name", type_option(TYPE_VARCHAR)));
+    keyspaces.columns.push_back(Column("durable_writes", type_option(TYPE_BOOLEAN)));
+    keyspaces.columns.push_back(Column("replication",
+                                       type_option(TYPE_MAP) + type_option(TYPE_VARCHAR) +
+                                       type_option(TYPE_VARCHAR)));
+    add_table(keyspaces);
+  }
+
+  std::string map;
+  encode_int(&map, static_cast<int32_t>(replication.size()));
+  for (const auto& option : replication) {
+    encode_bytes(&map, option.first);
+    encode_bytes(&map, option.second);
+  }
+  std::vector<std::string> row;
+  row.push_back(bytes_value(name));
+  row.push_back(bytes_value(std::string(1, '\1')));
+  row.push_back(bytes_value(map));
+  tables_["system_schema.keyspaces"].rows.push_back(row);
+}
+
+static std::string host_id(size_t index) {
+  return uuid_value(0x0000000000004000ULL, 0x8000000000000000ULL | (index + 1));
+}
+
+static std::string tokens_value(int64_t token) {
+  return set_value(std::vector<std::string>(1, std::to_string(static_cast<long long>(token))));
+}
+
+void MockServer::add_system_tables(Node* node) {
+  std::string varchar(type_option(TYPE_VARCHAR));
+  std::string uuid(type_option(TYPE_UUID));
+  std::string inet(type_option(TYPE_INET));
+  std::string tokens(type_option(TYPE_SET) + varchar);
+  std::string schema_version(uuid_value(0x5f3e2a1b0c9d4e8fULL, 0xa1b2c3d4e5f60718ULL));
+
+  Table& local = node->local;
+  local.keyspace = "system";
+  local.name = "local";
+  local.partition_key_count = 1;
+  local.columns.push_back(Column("key", varchar));
+  local.columns.push_back(Column("bootstrapped", varchar));
+  local.columns.push_back(Column("broadcast_address", inet));
+  local.columns.push_back(Column("cluster_name", varchar));
+  local.columns.push_back(Column("cql_version", varchar));
+  local.columns.push_back(Column("data_center", varchar));
+  local.columns.push_back(Column("host_id", uuid));
+  local.columns.push_back(Column("listen_address", inet));
+  local.columns.push_back(Column("native_protocol_version", varchar));
+  local.columns.push_back(Column("partitioner", varchar));
+  local.columns.push_back(Column("rack", varchar));
+  local.columns.push_back(Column("release_version", varchar));
+  local.columns.push_back(Column("rpc_address", inet));
+  local.columns.push_back(Column("schema_version", uuid));
+  local.columns.push_back(Column("tokens", tokens));
+
+  Table& peers = node->peers;
+  peers.keyspace = "system";
+  peers.name = "peers";
+  peers.partition_key_count = 1;
+  peers.columns.push_back(Column("peer", inet));
+  peers.columns.push_back(Column("data_center", varchar));
+  peers.columns.push_back(Column("host_id", uuid));
+  peers.columns.push_back(Column("preferred_ip", inet));
+  peers.columns.push_back(Column("rack", varchar));
+  peers.columns.push_back(Column("release_version", varchar));
+  peers.columns.push_back(Column("rpc_address", inet));
+  peers.columns.push_back(Column("schema_version", uuid));
+  peers.columns.push_back(Column("tokens", tokens));
+
+  for (size_t i = 0; i < nodes_.size(); ++i) {
+    const Node* other = nodes_[i].get();
+    std::vector<std::string> row;
+    if (other == node) {
+      row.push_back(bytes_value("local"));
+      row.push_back(bytes_value("COMPLETED"));
+      row.push_back(inet_value(node->address));
+      row.push_back(bytes_value("Mock Cluster"));
+      row.push_back(bytes_value(CQL_VERSION));
+      row.push_back(bytes_value("dc1"));
+      row.push_back(host_id(i));
+      row.push_back(inet_value(node->address));
+      row.push_back(bytes_value("4"));
+      row.push_back(bytes_value(PARTITIONER));
+      row.push_back(bytes_value("rack1"));
+      row.push_back(bytes_value(RELEASE_VERSION));
+      row.push_back(inet_value(node->address));
+      row.push_back(schema_version);
+      row.push_back(tokens_value(node->token));
+      local.rows.push_back(row);
+    } else {
+      row.push_back(inet_value(other->address));
+      row.push_back(bytes_value("dc1"));
+      row.push_back(host_id(i));
+      row.push_back(inet_value(other->address));
+      row.push_back(bytes_value("rack1"));
+      row.push_back(bytes_value(RELEASE_VERSION));
+      row.push_back(inet_value(other->address));
+      row.push_back(schema_version);
+      row.push_back(tokens_value(other->token));
+      peers.rows.push_back(row);
+    }
+  }
+}
@@ -0,0 +1,225 @@
+#ifndef MOCK_SERVER_HPP
+#define MOCK_SERVER_HPP
+
+#include "config.hpp"
+#include "random.hpp"
+
+#include <uv.h>
+
+#include <atomic>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// A stand-in for a Cassandra node that speaks enough of native protocol v3
+// and v4 for the workloads: STARTUP, OPTIONS, REGISTER, QUERY, PREPARE,
+// EXECUTE and BATCH, plus the system.local and system.peers queries of the
+// driver and query_server_info(). Tables are learned from their CREATE TABLE
+// statement and every SELECT returns one canned row. Responses are encoded
+// once per statement so a run against it measures the client stack alone.
+// The server runs its own loop on a separate thread.
+//
+// With --mock-server-nodes it simulates a ring of nodes on 127.0.0.1,
+// 127.0.0.2, ... that each own an even token range and advertise the others
+// through system.peers. Every node counts the requests it coordinates and
+// how many of them it's a replica for, which shows what token-aware
+// routing achieves.
+//
+// Once the workloads start the server can also misbehave like a real one:
+// --mock-latency delays the responses to the workloads' requests,
+// --mock-errors answers a share of them with overloaded, unavailable or
+// read timeout errors, and --mock-disconnect-interval periodically closes
+// a random connection.
+class MockServer {
+public:
+  MockServer(const Config& config);
+  ~MockServer();
+
+  // Listens on every node's address and the configured port, returns false
+  // on failure
+  bool start();
+  void stop();
+
+  // Counts the requests of the workloads from here on and starts injecting
+  // latency and faults
+  void start_workloads();
+  // Stops counting and injecting while the data is primed again between
+  // trials, then carries on without resetting the counts
+  void pause_workloads();
+  void resume_workloads();
+  void print_counts(FILE* file) const;
+
+private:
+  struct Connection;
+  struct Write;
+
+  struct Column {
+    Column(const std::string& name, const std::string& type)
+      : name(name)
+      , type(type) { }
+
+    std::string name;
+    std::string type; // Encoded as a protocol [option]
+  };
+
+  struct Table {
+    Table()
+      : partition_key_count(0) { }
+
+    std::string keyspace;
+    std::string name;
+    std::vector<Column> columns; // The partition key columns come first
+    size_t partition_key_count;
+    std::vector<std::vector<std::string> > rows; // Encoded as protocol [bytes]
+  };
+
+  // The canned responses for a query string
+  struct Statement {
+    Statement()
+      : opcode(0)
+      , is_system(false)
+      , replication_factor(1) { }
+
+    std::string id;
+    int opcode; // A result, or an error for invalid queries
+    std::string result;
+    std::string result_without_metadata; // For executions that skip it
+    std::string prepared[2]; // Protocol v4 adds the partition key indices
+    bool is_system; // On a system table, the driver's own queries
+    std::vector<int> partition_key_indices;
+    int replication_factor;
+  };
+
+  struct Node {
+    Node()
+      : server(NULL)
+      , token(0)
+      , pause_offset(0)
+      , num_requests(0)
+      , num_routable(0)
+      , num_on_replica(0)
+      , num_errors(0)
+      , num_disconnects(0) { }
+
+    MockServer* server;
+    std::string address;
+    int64_t token; // Owns the range (previous node's token, token]
+    uint64_t pause_offset; // Nodes pause at different times
+    uv_tcp_t listener;
+    Table local;
+    Table peers;
+    std::unordered_map<std::string, Statement> statements; // By query
+    std::unordered_map<std::string, const Statement*> prepared; // By id
+    std::atomic<int64_t> num_requests;
+    std::atomic<int64_t> num_routable; // Had a partition key to route by
+    std::atomic<int64_t> num_on_replica;
+    std::atomic<int64_t> num_errors;
+    std::atomic<int64_t> num_disconnects;
+  };
+
+  // A response held back by the injected latency
+  struct Delayed {
+    uint64_t due; // In uv_hrtime() nanoseconds
+    Connection* connection;
+    int version;
+    int stream;
+    int opcode;
+    const std::string* body; // Always one of the canned bodies
+
+    bool operator>(const Delayed& other) const { return due > other.due; }
+  };
+
+  static void on_connection(uv_stream_t* stream, int status);
+  static void on_alloc(uv_handle_t* handle, size_t suggested_size, uv_buf_t* buf);
+  static void on_read(uv_stream_t* stream, ssize_t nread, const uv_buf_t* buf);
+  static void on_write(uv_write_t* req, int status);
+  static void on_close(uv_handle_t* handle);
+  static void on_stop(uv_async_t* async);
+  static void on_delay(uv_async_t* async);
+  static void on_disconnect(uv_timer_t* timer);
+  static void run(void* arg);
+  // The loop's timers only have a resolution of a millisecond so a thread
+  // sleeps until the next delayed response is due and wakes the loop up
+  static void run_sleeper(void* arg);
+  void wake_at(uint64_t due);
+
+  // Responds to every complete frame in the connection's input and returns
+  // the number of bytes consumed, or -1 when the input isn't a valid frame
+  ssize_t process(Connection* connection, Write* write);
+  void close(Connection* connection);
+  void write(Connection* connection, Write* write);
+
+  // Adds the response to a workload request, or holds it back until the
+  // injected latency has passed. An injected error replaces the result.
+  void add_workload_response(Connection* connection, Write* write, int version, int stream,
+                             int opcode, const std::string* body);
+  // Writes the delayed responses that are due and returns the time the next
+  // one is due, 0 when none are left
+  uint64_t write_delayed();
+  uint64_t due_time(const Node* node, uint64_t now);
+  const std::string* next_error();
+
+  // Counts a request and whether the node owns a replica of the partition
+  // key bound by its values
+  void count(Node* node, const Statement& statement, const char* values, size_t size, int flags);
+  bool is_replica(const Node* node, int64_t token, int replication_factor) const;
+
+  static void add_response(Write* write, int version, int stream, int opcode, const std::string* body);
+  static void encode_metadata(std::string* body, const std::string& keyspace, const std::string& table,
+                              const std::vector<Column>& columns);
+  // Learns a table from "CREATE TABLE [IF NOT EXISTS] ks.table (...)"
+  static bool parse_table(const std::vector<std::string>& tokens, int data_size, Table* table);
+
+  // Statements on the system tables are rebuilt for every query so they see
+  // the keyspaces created since, the others are encoded once
+  const Statement& statement(Node* node, const std::string& query, Write* write);
+  Statement build_statement(const Node* node, const std::string& query);
+  const Table* find_table(const Node* node, const std::string& name) const;
+  void add_table(const Table& table);
+  void add_keyspace(const std::vector<std::string>& tokens);
+  void add_system_tables(Node* node);
+
+private:
+  int port_;
+  int data_size_;
+  uv_loop_t loop_;
+  uv_async_t stop_async_;
+  uv_async_t delay_async_;
+  uv_timer_t disconnect_timer_;
+  uv_thread_t thread_;
+  bool is_running_;
+  std::atomic<bool> is_injecting_;
+  uv_thread_t sleeper_thread_;
+  uv_mutex_t sleeper_mutex_;
+  uv_cond_t sleeper_cond_;
+  uint64_t sleeper_due_; // 0 when no delayed response is pending
+  bool is_sleeper_stopping_;
+  int latency_type_;
+  uint64_t latency_ns_; // Fixed, the median for lognormal or the base between pauses
+  double latency_sigma_;
+  uint64_t pause_interval_ns_;
+  uint64_t pause_ns_;
+  uint64_t start_time_;
+  double overloaded_percent_;
+  double unavailable_percent_;
+  double read_timeout_percent_;
+  int disconnect_interval_; // In milliseconds
+  Random random_;
+  std::priority_queue<Delayed, std::vector<Delayed>, std::greater<Delayed> > delayed_;
+  std::vector<std::unique_ptr<Node> > nodes_; // In token order
+  std::unordered_set<Connection*> connections_;
+  std::unordered_map<std::string, Table> tables_; // By "keyspace.table"
+  std::unordered_map<std::string, int> replication_factors_; // By keyspace
+  std::string supported_;
+  std::string void_result_;
+  std::string overloaded_error_;
+  std::string unavailable_error_;
+  std::string read_timeout_error_;
+};
+
+#endif // MOCK_SERVER_HPP
@@ -0,0 +1,25 @@
+#include "prepared_cache.hpp"
+
+#include "utils.hpp"
+
+#include <cstdlib>
+
+PreparedCache::~PreparedCache() {
+  for (auto& entry : prepared_) {
+    cass_prepared_free(entry.second);
+  }
+}
+
+const CassPrepared* PreparedCache::get(const std::string& query) {
+  auto it = prepared_.find(query);
+  if (it != prepared_.end()) {
+    return it->second;
+  }
+
+  const CassPrepared* prepared = NULL;
+  if (prepare_query(session_, query.c_str(), &prepared) != CASS_OK) {
+    exit(-1);
+  }
+  prepared_[query] = prepared;
+  return prepared;
+}
@@ -0,0 +1,26 @@
+#ifndef PREPARED_CACHE_HPP
+#define PREPARED_CACHE_HPP
+
+#include "driver.hpp"
+
+#include <map>
+#include <string>
+
+// Prepared statements shared by every benchmark run on a session so that
+// consecutive runs don't prepare the same query again
+class PreparedCache {
+public:
+  PreparedCache(CassSession* session)
+    : session_(session) { }
+
+  ~PreparedCache();
+
+  // Returns the prepared statement for "query", preparing it the first time
+  const CassPrepared* get(const std::string& query);
+
+private:
+  CassSession* const session_;
+  std::map<std::string, const CassPrepared*> prepared_;
+};
+
+#endif // PREPARED_CACHE_HPP
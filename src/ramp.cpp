@@ -0,0 +1,95 @@
+#include "ramp.hpp"
+
+#include "runner.hpp"
+
+#include <memory>
+#include <vector>
+
+// A step is past the knee when its throughput grew by less than
+// KNEE_RATE_GROWTH over the previous step's while its p99 latency rose, or
+// when it delivered less than KNEE_DELIVERED_RATE of its --target-rate
+#define KNEE_RATE_GROWTH 0.05
+#define KNEE_DELIVERED_RATE 0.95
+
+struct RampStep {
+  int load;
+  RunResult result;
+};
+
+static bool is_past_knee(const RampStep& previous, const RampStep& step, bool is_rate) {
+  if (is_rate && step.result.rate < KNEE_DELIVERED_RATE * step.load) {
+    return true;
+  }
+  return step.result.rate < (1.0 + KNEE_RATE_GROWTH) * previous.result.rate &&
+      step.result.latencies->percentile(99.0) > previous.result.latencies->percentile(99.0);
+}
+
+// Returns the index of the last step before the knee, or the last step if
+// the load never saturated
+static size_t find_saturation(const std::vector<RampStep>& steps, bool is_rate, bool* is_saturated) {
+  *is_saturated = false;
+  for (size_t i = 1; i < steps.size(); ++i) {
+    if (is_past_knee(steps[i - 1], steps[i], is_rate)) {
+      *is_saturated = true;
+      return i - 1;
+    }
+  }
+  return steps.size() - 1;
+}
+
+void run_ramp(CassSession* session, const Config& config,
+              PreparedCache* prepared_cache, FILE* file) {
+  bool is_rate = config.ramp_type == "rate";
+  std::vector<RampStep> steps;
+
+  for (int load = config.ramp_start; load <= config.ramp_stop; load += config.ramp_step) {
+    Config step_config(config);
+    if (is_rate) {
+      step_config.target_rate = load;
+    } else {
+      step_config.num_concurrent_requests = load;
+    }
+
+    std::unique_ptr<Benchmark> benchmark(create_benchmark(session, step_config));
+    benchmark->set_prepared_cache(prepared_cache);
+    benchmark->setup();
+
+    fprintf(file, "\nramp-step, %s %d\n", config.ramp_type.c_str(), load);
+    RampStep step;
+    step.load = load;
+    step.result = run_benchmark(benchmark.get(), session, step_config, file);
+    steps.push_back(step);
+  }
+
+  // Latencies are in microseconds
+  fprintf(file,
+          "\nramp\n"
+          "%12s, %12s, %10s, "
+          "%10s, %10s, %10s, %10s, "
+          "%10s, %10s\n",
+          config.ramp_type.c_str(), "num_requests", "rate",
+          "mean", "median", "95th", "99th",
+          "99.9th", "max");
+  for (const auto& step : steps) {
+    const Histogram& latencies = *step.result.latencies;
+    fprintf(file,
+            "%12d, %12lld, %10g, "
+            "%10llu, %10llu, %10llu, %10llu, "
+            "%10llu, %10llu\n",
+            step.load, step.result.num_requests, step.result.rate,
+            (unsigned long long int)latencies.mean() / 1000, (unsigned long long int)latencies.percentile(50.0) / 1000,
+            (unsigned long long int)latencies.percentile(95.0) / 1000, (unsigned long long int)latencies.percentile(99.0) / 1000,
+            (unsigned long long int)latencies.percentile(99.9) / 1000, (unsigned long long int)latencies.max() / 1000);
+  }
+
+  bool is_saturated;
+  const RampStep& saturation = steps[find_saturation(steps, is_rate, &is_saturated)];
+  fprintf(file,
+          "\nsaturation\n"
+          "%12s, %10s, %10s, %10s\n"
+          "%12d, %10g, %10llu, %10s\n",
+          config.ramp_type.c_str(), "rate", "99th", "knee found",
+          saturation.load, saturation.result.rate,
+          (unsigned long long int)saturation.result.latencies->percentile(99.0) / 1000,
+          is_saturated ? "yes" : "no");
+}
@@ -0,0 +1,17 @@
+#ifndef RAMP_HPP
+#define RAMP_HPP
+
+#include "config.hpp"
+#include "driver.hpp"
+#include "prepared_cache.hpp"
+
+#include <cstdio>
+
+// Steps the offered load (--num-concurrent-requests or --target-rate) from
+// the start to the stop of --ramp on a single session. Each step runs for
+// --warmup plus --duration seconds. Prints the throughput/latency curve and
+// the saturation point found at the curve's knee.
+void run_ramp(CassSession* session, const Config& config,
+              PreparedCache* prepared_cache, FILE* file);
+
+#endif // RAMP_HPP
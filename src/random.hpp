@@ -0,0 +1,41 @@
+#ifndef RANDOM_HPP
+#define RANDOM_HPP
+
+#include <uv.h>
+
+#include <stdint.h>
+
+// A small xorshift64* generator. It is cheap enough to call for every
+// request, and local() gives each thread its own so there's no contention.
+class Random {
+public:
+  Random(uint64_t seed)
+    : state_(seed != 0 ? seed : 0x9E3779B97F4A7C15ULL) { }
+
+  uint64_t next() {
+    state_ ^= state_ >> 12;
+    state_ ^= state_ << 25;
+    state_ ^= state_ >> 27;
+    return state_ * 0x2545F4914F6CDD1DULL;
+  }
+
+  // Returns a value in [0, bound)
+  uint64_t next(uint64_t bound) {
+    return next() % bound;
+  }
+
+  // Returns a value in [0.0, 1.0)
+  double next_double() {
+    return (next() >> 11) * (1.0 / 9007199254740992.0);
+  }
+
+  static Random& local() {
+    static thread_local Random random(uv_hrtime() ^ reinterpret_cast<uintptr_t>(&random));
+    return random;
+  }
+
+private:
+  uint64_t state_;
+};
+
+#endif // RANDOM_HPP
@@ -0,0 +1,42 @@
+#ifndef RATE_LIMITER_HPP
+#define RATE_LIMITER_HPP
+
+#include <uv.h>
+
+#include <chrono>
+#include <thread>
+
+// Hands out the intended send times of a fixed rate schedule. The schedule is
+// absolute, so a caller that falls behind (e.g. blocked on a full window)
+// catches up by sending immediately instead of silently lowering the rate.
+class RateLimiter {
+public:
+  RateLimiter(double rate)
+    : interval_ns_(1000.0 * 1000.0 * 1000.0 / rate)
+    , start_(uv_hrtime())
+    , count_(0) { }
+
+  // Waits until the next intended send time and returns it
+  uint64_t acquire() {
+    uint64_t intended_time = start_ + static_cast<uint64_t>(count_++ * interval_ns_);
+    uint64_t now = uv_hrtime();
+    // Sleeping overshoots by tens of microseconds so spin for the remainder
+    if (intended_time > now + SPIN_THRESHOLD_NS) {
+      std::this_thread::sleep_for(
+            std::chrono::nanoseconds(intended_time - now - SPIN_THRESHOLD_NS));
+    }
+    while (uv_hrtime() < intended_time) {
+      std::this_thread::yield();
+    }
+    return intended_time;
+  }
+
+private:
+  static const uint64_t SPIN_THRESHOLD_NS = 100 * 1000;
+
+  const double interval_ns_;
+  const uint64_t start_;
+  uint64_t count_;
+};
+
+#endif // RATE_LIMITER_HPP
@@ -0,0 +1,352 @@
+#include "runner.hpp"
+
+#include "callback_benchmark.hpp"
+#include "chunking_benchmark.hpp"
+#include "ramp.hpp"
+#include "slo_search.hpp"
+#include "utils.hpp"
+
+#include "date.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+#include <uv.h>
+
+CassCluster* create_cluster(const Config& config) {
+  CassCluster* cluster = cass_cluster_new();
+
+  cass_cluster_set_contact_points(cluster, config.hosts.c_str());
+  cass_cluster_set_port(cluster, config.port);
+
+#if 0
+  CassRetryPolicy* retry_policy = cass_retry_policy_fallthrough_new();
+  cass_cluster_set_retry_policy(cluster, retry_policy);
+  cass_retry_policy_free(retry_policy);
+
+  cass_cluster_set_latency_aware_routing(cluster, cass_true);
+#endif
+
+  cass_cluster_set_connect_timeout(cluster, 10000);
+  cass_cluster_set_reconnect_wait_time(cluster, 5000);
+  cass_cluster_set_tcp_keepalive(cluster, cass_true, 15);
+
+  if (config.use_ssl) {
+    CassSsl* ssl = cass_ssl_new();
+    cass_ssl_set_verify_flags(ssl, CASS_SSL_VERIFY_PEER_CERT);
+    if (!load_trusted_cert_file(config.trusted_cert_file.c_str(), ssl)) {
+      fprintf(stderr, "Failed to load certificate '%s' disabling peer verification\n",
+              config.trusted_cert_file.c_str());
+      cass_ssl_set_verify_flags(ssl, CASS_SSL_VERIFY_NONE);
+    }
+    cass_cluster_set_ssl(cluster, ssl);
+    cass_ssl_free(ssl);
+  }
+
+  if (config.protocol_version > 0 && cass_cluster_set_protocol_version(cluster, config.protocol_version) != CASS_OK) {
+    fprintf(stderr, "protocol version %d not supported using default\n", config.protocol_version);
+  }
+
+  cass_cluster_set_token_aware_routing(cluster, config.use_token_aware ? cass_true : cass_false);
+  cass_cluster_set_num_threads_io(cluster, config.num_io_threads);
+  cass_cluster_set_queue_size_io(cluster,
+                                 2 * config.num_concurrent_requests * std::max(config.num_threads, config.num_io_threads));
+
+  cass_cluster_set_core_connections_per_host(cluster, config.num_core_connections);
+  cass_cluster_set_max_connections_per_host(cluster, config.num_core_connections);
+
+  cass_cluster_set_pending_requests_high_water_mark(cluster,
+                                                    2 * config.num_concurrent_requests * std::max(config.num_threads, config.num_io_threads));
+  cass_cluster_set_write_bytes_high_water_mark(cluster, config.num_concurrent_requests * 16 * 1048576);
+
+  return cluster;
+}
+
+Benchmark* create_benchmark(CassSession* session, const Config& config) {
+  if (config.type == "select") {
+    return new SelectChunkingBenchmark(session, config);
+  } else if (config.type == "insert") {
+    return new InsertChunkingBenchmark(session, config);
+  } else if (config.type == "selectcallback") {
+    return new SelectCallbackBenchmark(session, config);
+  } else if (config.type == "insertcallback") {
+    return new InsertCallbackBenchmark(session, config);
+  } else if (config.type == "insertbatch") {
+    return new BatchChunkingBenchmark(session, config, CASS_BATCH_TYPE_LOGGED);
+  } else if (config.type == "unloggedbatch") {
+    return new BatchChunkingBenchmark(session, config, CASS_BATCH_TYPE_UNLOGGED);
+  } else if (config.type == "counterbatch") {
+    return new BatchChunkingBenchmark(session, config, CASS_BATCH_TYPE_COUNTER);
+  } else if (config.type == "mixed") {
+    return new MixedChunkingBenchmark(session, config);
+  }
+  return NULL;
+}
+
+RunResult run_benchmark(Benchmark* benchmark, CassSession* session,
+                        const Config& config, FILE* file) {
+  RunResult result;
+  bool first = true;
+  uint64_t interval_start = uv_hrtime();
+  benchmark->run();
+  while (benchmark->poll(config.sampling_rate)) {
+    if (first) {
+      fprintf(file, "\n%30s, ", "timestamp");
+#if CASS_VERSION_MAJOR >= 2
+      fprintf(file,
+              "%10s, %10s, %10s, %10s, "
+              "%10s, %10s, %10s, %10s, "
+              "%10s, %10s, %10s, %10s, "
+              "%10s, ",
+              "mean rate", "1m rate", "5m rate", "10m rate",
+              "min", "mean", "median", "75th",
+              "95th", "98th", "99th", "99.9th",
+              "max");
+#endif
+      fprintf(file,
+              "%14s, %14s, %15s, "
+              "%14s, %14s, %14s, %14s, "
+              "%14s, %14s, %14s, %14s, "
+              "%14s, %6s",
+              "interval count", "interval rate", "interval errors",
+              "interval min", "interval mean", "interval med", "interval 75th",
+              "interval 95th", "interval 98th", "interval 99th", "interval 99.9",
+              "interval max", "steady");
+      if (config.use_adaptive_concurrency) {
+        fprintf(file, ", %10s", "window");
+      }
+      fprintf(file, "\n");
+      first = false;
+    }
+    std::string date(date::format("%F %T", std::chrono::system_clock::now()));
+    fprintf(file, "%30s, ", date.c_str());
+#if CASS_VERSION_MAJOR >= 2
+    CassMetrics metrics;
+    cass_session_get_metrics(session, &metrics);
+    fprintf(file,
+            "%10g, %10g, %10g, %10g, "
+            "%10llu, %10llu, %10llu, %10llu, "
+            "%10llu, %10llu, %10llu, %10llu, "
+            "%10llu, ",
+            metrics.requests.mean_rate, metrics.requests.one_minute_rate,
+            metrics.requests.five_minute_rate, metrics.requests.fifteen_minute_rate,
+            (unsigned long long int)metrics.requests.min, (unsigned long long int)metrics.requests.mean,
+            (unsigned long long int)metrics.requests.median, (unsigned long long int)metrics.requests.percentile_75th,
+            (unsigned long long int)metrics.requests.percentile_95th, (unsigned long long int)metrics.requests.percentile_98th,
+            (unsigned long long int)metrics.requests.percentile_99th, (unsigned long long int)metrics.requests.percentile_999th,
+            (unsigned long long int)metrics.requests.max);
+#endif
+    // The harness's own latencies (in microseconds) of the successful requests
+    // of all operations recorded during this sample only, the failed requests,
+    // and whether the whole sample was in the steady-state window
+    uint64_t now = uv_hrtime();
+    double interval_secs = (now - interval_start) / (1000.0 * 1000.0 * 1000.0);
+    Histogram latencies;
+    benchmark->interval_latencies(&latencies);
+    Histogram errors;
+    benchmark->interval_errors(&errors);
+    bool is_steady_state = benchmark->is_steady_state(interval_start, now);
+    if (is_steady_state) {
+      result.intervals.push_back(IntervalSample(latencies.count() / interval_secs,
+                                                latencies.percentile(99.0)));
+    }
+    interval_start = now;
+    fprintf(file,
+            "%14llu, %14g, %15llu, "
+            "%14llu, %14llu, %14llu, %14llu, "
+            "%14llu, %14llu, %14llu, %14llu, "
+            "%14llu, %6d",
+            (unsigned long long int)latencies.count(), latencies.count() / interval_secs,
+            (unsigned long long int)errors.count(),
+            (unsigned long long int)latencies.min() / 1000, (unsigned long long int)latencies.mean() / 1000,
+            (unsigned long long int)latencies.percentile(50.0) / 1000, (unsigned long long int)latencies.percentile(75.0) / 1000,
+            (unsigned long long int)latencies.percentile(95.0) / 1000, (unsigned long long int)latencies.percentile(98.0) / 1000,
+            (unsigned long long int)latencies.percentile(99.0) / 1000, (unsigned long long int)latencies.percentile(99.9) / 1000,
+            (unsigned long long int)latencies.max() / 1000,
+            is_steady_state ? 1 : 0);
+    // The in-flight limit the adaptive concurrency settled on for the sample
+    if (config.use_adaptive_concurrency) {
+      fprintf(file, ", %10d", benchmark->concurrency_limit());
+    }
+    fprintf(file, "\n");
+  }
+
+  benchmark->join();
+
+  benchmark->latencies(result.latencies.get());
+  result.num_requests = static_cast<long long>(result.latencies->count());
+  Histogram errors;
+  benchmark->errors(&errors);
+  result.num_errors = static_cast<long long>(errors.count());
+  result.secs = benchmark->measured_secs();
+  result.rate = result.secs > 0.0 ? result.num_requests / result.secs : 0.0;
+  return result;
+}
+
+void print_summary(Benchmark* benchmark, CassSession* session,
+                   const Config& config, const RunResult& result,
+                   bool is_warm_session, FILE* file) {
+  // The summary only covers the steady-state window so the warmup (and any
+  // cooldown) doesn't skew the rates. The driver's metrics can't be reset
+  // and still include every request.
+
+  CassMetrics metrics;
+  cass_session_get_metrics(session, &metrics);
+
+  if (is_warm_session) {
+    fprintf(file, "\nsummary (driver latencies are session-cumulative)");
+  }
+  fprintf(file,
+          "\n%12s, %10s, %10s, %10s,"
+          "%10s, %10s, %10s, %10s, "
+          "%10s, %10s, %10s, %10s, "
+          "%10s\n"
+          "%12lld, %10lld, %10g, %10g,"
+          "%10llu, %10llu, %10llu, %10llu, "
+          "%10llu, %10llu, %10llu, %10llu, "
+          "%10llu\n",
+          "num_requests", "num_errors", "duration", "final rate",
+          "min", "mean", "median", "75th",
+          "95th", "98th", "99th", "99.9th",
+          "max",
+          result.num_requests, result.num_errors, result.secs, result.rate,
+          (unsigned long long int)metrics.requests.min, (unsigned long long int)metrics.requests.mean,
+          (unsigned long long int)metrics.requests.median, (unsigned long long int)metrics.requests.percentile_75th,
+          (unsigned long long int)metrics.requests.percentile_95th, (unsigned long long int)metrics.requests.percentile_98th,
+          (unsigned long long int)metrics.requests.percentile_99th, (unsigned long long int)metrics.requests.percentile_999th,
+          (unsigned long long int)metrics.requests.max);
+
+  if (benchmark->statements_per_request() > 1) {
+    // Each request carries several statements (e.g. a batch) so report the
+    // statement rate too for comparison with single statement workloads
+    int statements_per_request = benchmark->statements_per_request();
+    fprintf(file,
+            "\n%12s, %14s, %14s\n"
+            "%12d, %14lld, %14g\n",
+            "statements", "num_statements", "statement rate",
+            statements_per_request,
+            result.num_requests * statements_per_request,
+            result.rate * statements_per_request);
+  }
+
+  // Client-side latencies (in microseconds) for each operation. When running
+  // at a fixed rate these are measured from each request's intended send
+  // time so they include any time spent waiting behind a stalled cluster.
+  // Only successful requests are in the latencies and rate.
+  fprintf(file,
+          "\n%s\n"
+          "%16s, %12s, %10s, %10s, "
+          "%10s, %10s, %10s, %10s, "
+          "%10s, %10s, %10s, %10s, "
+          "%10s\n",
+          config.target_rate > 0 ? "client-latencies (from intended send time)" : "client-latencies",
+          "operation", "num_requests", "num_errors", "rate",
+          "min", "mean", "median", "75th",
+          "95th", "98th", "99th", "99.9th",
+          "max");
+  for (size_t i = 0; i < benchmark->num_operations(); ++i) {
+    Histogram latencies;
+    benchmark->operation_latencies(i, &latencies);
+    Histogram errors;
+    benchmark->operation_errors(i, &errors);
+    fprintf(file,
+            "%16s, %12llu, %10llu, %10g, "
+            "%10llu, %10llu, %10llu, %10llu, "
+            "%10llu, %10llu, %10llu, %10llu, "
+            "%10llu\n",
+            benchmark->operation_name(i).c_str(),
+            (unsigned long long int)latencies.count(), (unsigned long long int)errors.count(),
+            result.secs > 0.0 ? latencies.count() / result.secs : 0.0,
+            (unsigned long long int)latencies.min() / 1000, (unsigned long long int)latencies.mean() / 1000,
+            (unsigned long long int)latencies.percentile(50.0) / 1000, (unsigned long long int)latencies.percentile(75.0) / 1000,
+            (unsigned long long int)latencies.percentile(95.0) / 1000, (unsigned long long int)latencies.percentile(98.0) / 1000,
+            (unsigned long long int)latencies.percentile(99.0) / 1000, (unsigned long long int)latencies.percentile(99.9) / 1000,
+            (unsigned long long int)latencies.max() / 1000);
+  }
+
+  // How long the failed requests took (in microseconds) to fail
+  if (result.num_errors > 0) {
+    fprintf(file,
+            "\nclient-errors\n"
+            "%16s, %10s, %8s, "
+            "%10s, %10s, %10s, %10s, "
+            "%10s\n",
+            "operation", "num_errors", "error %",
+            "min", "median", "99th", "99.9th",
+            "max");
+    for (size_t i = 0; i < benchmark->num_operations(); ++i) {
+      Histogram latencies;
+      benchmark->operation_latencies(i, &latencies);
+      Histogram errors;
+      benchmark->operation_errors(i, &errors);
+      uint64_t total = latencies.count() + errors.count();
+      fprintf(file,
+              "%16s, %10llu, %8.2f, "
+              "%10llu, %10llu, %10llu, %10llu, "
+              "%10llu\n",
+              benchmark->operation_name(i).c_str(),
+              (unsigned long long int)errors.count(),
+              total > 0 ? 100.0 * errors.count() / total : 0.0,
+              (unsigned long long int)errors.min() / 1000, (unsigned long long int)errors.percentile(50.0) / 1000,
+              (unsigned long long int)errors.percentile(99.0) / 1000, (unsigned long long int)errors.percentile(99.9) / 1000,
+              (unsigned long long int)errors.max() / 1000);
+    }
+  }
+
+  if (config.use_null_driver) {
+    // Nothing was sent so the rates are the most the harness can submit.
+    // Creating and binding a request is timed per operation, the rest of the
+    // submitting threads' time per request (the run loop, completions and
+    // latency recording) is shared by all of them.
+    Histogram execute_times;
+    for (size_t i = 0; i < benchmark->num_operations(); ++i) {
+      benchmark->operation_execute_times(i, &execute_times);
+    }
+    double total_ns = result.num_requests > 0
+                      ? benchmark->num_threads() * result.secs * 1e9 / result.num_requests : 0.0;
+    double overhead_ns = std::max(total_ns - execute_times.mean(), 0.0);
+
+    fprintf(file,
+            "\nnull-driver\n"
+            "%16s, %12s, %12s, %12s, %10s\n",
+            "operation", "num_requests", "max rate", "execute ns", "ns/op");
+    for (size_t i = 0; i < benchmark->num_operations(); ++i) {
+      Histogram operation_execute_times;
+      benchmark->operation_execute_times(i, &operation_execute_times);
+      fprintf(file, "%16s, %12llu, %12g, %12g, %10g\n",
+              benchmark->operation_name(i).c_str(),
+              (unsigned long long int)operation_execute_times.count(),
+              result.secs > 0.0 ? operation_execute_times.count() / result.secs : 0.0,
+              operation_execute_times.mean(), operation_execute_times.mean() + overhead_ns);
+    }
+    fprintf(file, "%16s, %12lld, %12g, %12g, %10g\n",
+            "all", result.num_requests, result.rate, execute_times.mean(), total_ns);
+  }
+}
+
+void run_workload(CassSession* session, const Config& config,
+                  PreparedCache* prepared_cache, bool is_warm_session, FILE* file) {
+  if (!config.ramp_type.empty()) {
+    run_ramp(session, config, prepared_cache, file);
+    return;
+  }
+
+  if (config.slo_p99 > 0) {
+    run_slo_search(session, config, prepared_cache, file);
+    return;
+  }
+
+  std::unique_ptr<Benchmark> benchmark(create_benchmark(session, config));
+  if (!benchmark) {
+    fprintf(stderr, "Invalid test type: %s\n", config.type.c_str());
+    exit(-1);
+  }
+  benchmark->set_prepared_cache(prepared_cache);
+  benchmark->setup();
+
+  RunResult result = run_benchmark(benchmark.get(), session, config, file);
+  print_summary(benchmark.get(), session, config, result, is_warm_session, file);
+}
@@ -0,0 +1,63 @@
+#ifndef RUNNER_HPP
+#define RUNNER_HPP
+
+#include "benchmark.hpp"
+#include "config.hpp"
+#include "driver.hpp"
+#include "histogram.hpp"
+#include "prepared_cache.hpp"
+
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+// The throughput and p99 latency (in nanoseconds) of a single sample
+struct IntervalSample {
+  IntervalSample(double rate, uint64_t p99)
+    : rate(rate)
+    , p99(p99) { }
+
+  double rate;
+  uint64_t p99;
+};
+
+// The steady-state results of a single run
+struct RunResult {
+  RunResult()
+    : num_requests(0)
+    , num_errors(0)
+    , secs(0.0)
+    , rate(0.0)
+    , latencies(new Histogram()) { }
+
+  long long num_requests; // Successful requests only
+  long long num_errors;
+  double secs;
+  double rate;
+  std::shared_ptr<Histogram> latencies; // All operations, in nanoseconds
+  std::vector<IntervalSample> intervals; // Samples entirely in the steady state
+};
+
+CassCluster* create_cluster(const Config& config);
+
+// Returns NULL for an unknown --type
+Benchmark* create_benchmark(CassSession* session, const Config& config);
+
+// Runs a benchmark that has already been set up (and primed), printing a
+// row of samples every --sampling-rate milliseconds to "file"
+RunResult run_benchmark(Benchmark* benchmark, CassSession* session,
+                        const Config& config, FILE* file);
+
+// Prints the driver's metrics and the client latencies of each operation.
+// The driver's metrics can't be reset, on a warm session (one that already
+// ran earlier scenarios or trials) they're labeled as session-cumulative.
+void print_summary(Benchmark* benchmark, CassSession* session,
+                   const Config& config, const RunResult& result,
+                   bool is_warm_session, FILE* file);
+
+// Sets up and runs the workload "config" describes (a ramp, an SLO search or
+// a single run) on a connected session whose data has already been primed
+void run_workload(CassSession* session, const Config& config,
+                  PreparedCache* prepared_cache, bool is_warm_session, FILE* file);
+
+#endif // RUNNER_HPP
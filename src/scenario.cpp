@@ -0,0 +1,138 @@
+#include "scenario.hpp"
+
+#include "runner.hpp"
+
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <string>
+
+// Splits a line into arguments on whitespace, double quotes group words
+static std::vector<std::string> split_args(const std::string& line) {
+  std::vector<std::string> args;
+  std::string arg;
+  bool is_quoted = false;
+  bool has_arg = false;
+  for (char c : line) {
+    if (c == '"') {
+      is_quoted = !is_quoted;
+      has_arg = true;
+    } else if (!is_quoted && isspace(static_cast<unsigned char>(c))) {
+      if (has_arg) {
+        args.push_back(arg);
+        arg.clear();
+        has_arg = false;
+      }
+    } else {
+      arg.push_back(c);
+      has_arg = true;
+    }
+  }
+  if (has_arg) {
+    args.push_back(arg);
+  }
+  return args;
+}
+
+static bool is_shared_setting_changed(const Config& config, const Config& scenario) {
+  return scenario.hosts != config.hosts ||
+      scenario.port != config.port ||
+      scenario.use_mock_server != config.use_mock_server ||
+      scenario.mock_server_nodes != config.mock_server_nodes ||
+      scenario.mock_latency != config.mock_latency ||
+      scenario.mock_errors != config.mock_errors ||
+      scenario.mock_disconnect_interval != config.mock_disconnect_interval ||
+      scenario.num_io_threads != config.num_io_threads ||
+      scenario.num_core_connections != config.num_core_connections ||
+      scenario.protocol_version != config.protocol_version ||
+      scenario.use_token_aware != config.use_token_aware ||
+      scenario.use_ssl != config.use_ssl ||
+      scenario.trusted_cert_file != config.trusted_cert_file ||
+      scenario.num_partition_keys != config.num_partition_keys ||
+      scenario.key_seed != config.key_seed ||
+      scenario.data_size != config.data_size ||
+      scenario.reuse_dataset != config.reuse_dataset ||
+      scenario.scenario_file != config.scenario_file ||
+      scenario.is_sweep();
+}
+
+std::vector<Config> load_scenarios(const Config& config) {
+  std::ifstream file(config.scenario_file.c_str());
+  if (!file) {
+    fprintf(stderr, "Unable to open scenario file: %s\n", config.scenario_file.c_str());
+    exit(-1);
+  }
+
+  std::vector<Config> scenarios;
+  std::string line;
+  int line_number = 0;
+  while (std::getline(file, line)) {
+    line_number++;
+    std::vector<std::string> args(split_args(line));
+    if (args.empty() || args[0][0] == '#') {
+      continue;
+    }
+
+    std::vector<char*> argv;
+    argv.push_back(const_cast<char*>("scenario"));
+    for (auto& arg : args) {
+      argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+
+    Config scenario(config);
+    scenario.args_.clear();
+    scenario.from_cli(static_cast<int>(argv.size()), argv.data());
+    if (is_shared_setting_changed(config, scenario)) {
+      fprintf(stderr, "Scenario on line %d of '%s' changes a setting every scenario shares "
+                      "(hosts, connections, SSL, protocol, routing or the dataset)\n",
+              line_number, config.scenario_file.c_str());
+      exit(-1);
+    }
+    // Benchmarks don't use the session until they're set up
+    if (!std::unique_ptr<Benchmark>(create_benchmark(NULL, scenario))) {
+      fprintf(stderr, "Invalid test type on line %d of '%s': %s\n",
+              line_number, config.scenario_file.c_str(), scenario.type.c_str());
+      exit(-1);
+    }
+    scenarios.push_back(scenario);
+  }
+
+  if (scenarios.empty()) {
+    fprintf(stderr, "Scenario file '%s' has no scenarios\n", config.scenario_file.c_str());
+    exit(-1);
+  }
+
+  return scenarios;
+}
+
+int64_t prime_scenarios(CassSession* session, const std::vector<Config>& scenarios,
+                        PreparedCache* prepared_cache, bool is_primed) {
+  if (is_primed) {
+    return 0;
+  }
+
+  for (const auto& scenario : scenarios) {
+    std::unique_ptr<Benchmark> benchmark(create_benchmark(session, scenario));
+    if (!benchmark) {
+      fprintf(stderr, "Invalid test type: %s\n", scenario.type.c_str());
+      exit(-1);
+    }
+    benchmark->set_prepared_cache(prepared_cache);
+    benchmark->setup();
+    benchmark->prime();
+    if (benchmark->num_primed_keys() > 0) {
+      return benchmark->num_primed_keys();
+    }
+  }
+
+  return 0;
+}
+
+void run_scenarios(CassSession* session, const std::vector<Config>& scenarios,
+                   PreparedCache* prepared_cache, FILE* file) {
+  for (size_t i = 0; i < scenarios.size(); ++i) {
+    fprintf(file, "\nscenario, %u\n", static_cast<unsigned int>(i + 1));
+    scenarios[i].dump(file);
+    run_workload(session, scenarios[i], prepared_cache, i > 0, file);
+  }
+}
@@ -0,0 +1,28 @@
+#ifndef SCENARIO_HPP
+#define SCENARIO_HPP
+
+#include "config.hpp"
+#include "driver.hpp"
+#include "prepared_cache.hpp"
+
+#include <cstdio>
+#include <vector>
+
+// Loads the workloads listed in --scenario-file, one per line as flags
+// applied on top of the command line's. Blank lines and lines starting with
+// '#' are skipped. Scenarios share a session and primed data, so settings
+// that would need another cluster or dataset can't change. Exits on errors.
+std::vector<Config> load_scenarios(const Config& config);
+
+// Primes the data for the scenarios unless it's already primed. Every
+// workload that reads primed rows reads the same ones so only the first
+// scenario that needs them primes. Returns the number of rows written.
+int64_t prime_scenarios(CassSession* session, const std::vector<Config>& scenarios,
+                        PreparedCache* prepared_cache, bool is_primed);
+
+// Runs the scenarios one after another on the same session, each in its
+// own output block
+void run_scenarios(CassSession* session, const std::vector<Config>& scenarios,
+                   PreparedCache* prepared_cache, FILE* file);
+
+#endif // SCENARIO_HPP
@@ -1,18 +1,97 @@
 #include "schema.hpp"
 
-Uuid prime_select_query_data(CassSession* session, const std::string& data) {
-  CassStatement* statement = cass_statement_new(PRIMING_INSERT_QUERY, 2);
-  Uuid uuid(generate_random_uuid());
-  cass_statement_bind_uuid(statement, 0, uuid);
-  cass_statement_bind_string_n(statement, 1, data.c_str(), data.size());
-  CassFuture* future = cass_session_execute(session, statement);
-  cass_statement_free(statement);
-  CassError rc = cass_future_error_code(future);
-  if (rc != CASS_OK) {
+#include <uv.h>
+
+#include <atomic>
+#include <vector>
+
+struct PrimingThread {
+  CassSession* session;
+  const CassPrepared* prepared;
+  const KeySpace* key_space;
+  const std::string* data;
+  int64_t begin;
+  int64_t end;
+  int window_size;
+  uv_sem_t window;
+  std::atomic<int64_t>* failed_count;
+};
+
+static void on_primed(CassFuture* future, void* data) {
+  PrimingThread* thread = static_cast<PrimingThread*>(data);
+  if (cass_future_error_code(future) != CASS_OK) {
     print_error(future);
+    thread->failed_count->fetch_add(1);
+  }
+  uv_sem_post(&thread->window);
+}
+
+static void run_priming_thread(void* arg) {
+  PrimingThread* thread = static_cast<PrimingThread*>(arg);
+
+  for (int64_t i = thread->begin; i < thread->end; ++i) {
+    uv_sem_wait(&thread->window);
+    CassStatement* statement = cass_prepared_bind(thread->prepared);
+    cass_statement_set_is_idempotent(statement, cass_true);
+    cass_statement_bind_uuid(statement, 0, thread->key_space->key(i));
+    cass_statement_bind_string_n(statement, 1, thread->data->c_str(), thread->data->size());
+    CassFuture* future = cass_session_execute(thread->session, statement);
+    cass_future_set_callback(future, on_primed, thread);
     cass_future_free(future);
+    cass_statement_free(statement);
+  }
+
+  // Drain the outstanding inserts
+  for (int i = 0; i < thread->window_size; ++i) {
+    uv_sem_wait(&thread->window);
+  }
+}
+
+void truncate_tables(CassSession* session) {
+  execute_query(session, TRUNCATE_TABLE);
+  execute_query(session, TRUNCATE_BATCH_TABLE);
+  execute_query(session, TRUNCATE_COUNTER_TABLE);
+}
+
+void prime_select_query_data(CassSession* session, const KeySpace& key_space, int64_t num_keys,
+                             const std::string& data, int num_threads, int num_concurrent_requests) {
+  const CassPrepared* prepared = NULL;
+  if (prepare_query(session, PRIMING_INSERT_QUERY, &prepared) != CASS_OK) {
+    exit(-1);
+  }
+
+  std::atomic<int64_t> failed_count(0);
+  std::vector<PrimingThread> threads(num_threads);
+  std::vector<uv_thread_t> handles(num_threads);
+
+  int64_t begin = 0;
+  for (int i = 0; i < num_threads; ++i) {
+    PrimingThread& thread = threads[i];
+    thread.session = session;
+    thread.prepared = prepared;
+    thread.key_space = &key_space;
+    thread.data = &data;
+    thread.begin = begin;
+    thread.end = begin + num_keys / num_threads + (i < num_keys % num_threads ? 1 : 0);
+    thread.window_size = num_concurrent_requests;
+    uv_sem_init(&thread.window, num_concurrent_requests);
+    thread.failed_count = &failed_count;
+    begin = thread.end;
+  }
+
+  for (int i = 0; i < num_threads; ++i) {
+    uv_thread_create(&handles[i], run_priming_thread, &threads[i]);
+  }
+
+  for (int i = 0; i < num_threads; ++i) {
+    uv_thread_join(&handles[i]);
+    uv_sem_destroy(&threads[i].window);
+  }
+
+  cass_prepared_free(prepared);
+
+  if (failed_count.load() > 0) {
+    fprintf(stderr, "Failed to prime %lld rows\n", static_cast<long long>(failed_count.load()));
     exit(-1);
   }
-  cass_future_free(future);
-  return uuid;
 }
@@ -2,6 +2,7 @@
 #define SCHEMA_HPP
 
 #include "driver.hpp"
+#include "key_space.hpp"
 #include "utils.hpp"
 
 #include <string>
@@ -14,9 +15,23 @@
   "CREATE TABLE IF NOT EXISTS " \
   "perf.table1 (key uuid PRIMARY KEY, value varchar)"
 
+#define BATCH_TABLE_SCHEMA \
+  "CREATE TABLE IF NOT EXISTS " \
+  "perf.table2 (key uuid, id int, value varchar, PRIMARY KEY (key, id))"
+
+#define COUNTER_TABLE_SCHEMA \
+  "CREATE TABLE IF NOT EXISTS " \
+  "perf.counter1 (key uuid, id int, count counter, PRIMARY KEY (key, id))"
+
 #define TRUNCATE_TABLE \
   "TRUNCATE perf.table1"
 
+#define TRUNCATE_BATCH_TABLE \
+  "TRUNCATE perf.table2"
+
+#define TRUNCATE_COUNTER_TABLE \
+  "TRUNCATE perf.counter1"
+
 #define SELECT_QUERY \
   "SELECT * FROM perf.table1 WHERE key = ?"
 
@@ -26,6 +41,18 @@
 #define INSERT_QUERY \
   "INSERT INTO perf.table1 (key, value) VALUES (?, ?)"""
 
-Uuid prime_select_query_data(CassSession* session, const std::string& data);
+#define BATCH_INSERT_QUERY \
+  "INSERT INTO perf.table2 (key, id, value) VALUES (?, ?, ?)"
+
+#define COUNTER_UPDATE_QUERY \
+  "UPDATE perf.counter1 SET count = count + 1 WHERE key = ? AND id = ?"
+
+// Removes the rows of every table the workloads use
+void truncate_tables(CassSession* session);
+
+// Inserts the rows for keys [0, num_keys) using "num_threads" threads that
+// each keep up to "num_concurrent_requests" inserts in flight
+void prime_select_query_data(CassSession* session, const KeySpace& key_space, int64_t num_keys,
+                             const std::string& data, int num_threads, int num_concurrent_requests);
 
 #endif // SCHEMA_HPP
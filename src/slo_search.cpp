@@ -0,0 +1,137 @@
+#include "slo_search.hpp"
+
+#include "runner.hpp"
+#include "stats.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#define SLO_INITIAL_RATE 1000
+#define SLO_INITIAL_CONCURRENCY 8
+#define SLO_MAX_PROBES 20
+// The search stops once the compliant and violating loads are this close
+#define SLO_PRECISION 0.05
+// A paced probe that can't deliver its rate is overloaded whatever its p99
+#define SLO_DELIVERED_RATE 0.95
+
+struct SloProbe {
+  int load;
+  bool is_compliant;
+  RunResult result;
+};
+
+static Estimate estimate_rate(const RunResult& result) {
+  std::vector<double> values;
+  for (const auto& interval : result.intervals) {
+    values.push_back(interval.rate);
+  }
+  return estimate(values);
+}
+
+static Estimate estimate_p99(const RunResult& result) {
+  std::vector<double> values;
+  for (const auto& interval : result.intervals) {
+    values.push_back(interval.p99 / 1000.0);
+  }
+  Estimate p99 = estimate(values);
+  // Latencies are skewed so a symmetric interval can dip below zero
+  p99.lower = std::max(0.0, p99.lower);
+  return p99;
+}
+
+void run_slo_search(CassSession* session, const Config& config,
+                    PreparedCache* prepared_cache, FILE* file) {
+  bool is_rate = config.slo_control == "rate";
+  uint64_t slo_p99_ns = static_cast<uint64_t>(config.slo_p99) * 1000;
+  int max_load = is_rate ? std::numeric_limits<int>::max() / 2 : config.num_concurrent_requests;
+
+  int load = is_rate ? (config.target_rate > 0 ? config.target_rate : SLO_INITIAL_RATE)
+                     : SLO_INITIAL_CONCURRENCY;
+  load = std::min(load, max_load);
+
+  int compliant_load = 0; // The highest compliant load so far
+  int violating_load = 0; // The lowest violating load so far (0 if none)
+  std::vector<SloProbe> probes;
+
+  for (int i = 0; i < SLO_MAX_PROBES; ++i) {
+    Config probe_config(config);
+    if (is_rate) {
+      probe_config.target_rate = load;
+    } else {
+      probe_config.num_concurrent_requests = load;
+    }
+
+    std::unique_ptr<Benchmark> benchmark(create_benchmark(session, probe_config));
+    benchmark->set_prepared_cache(prepared_cache);
+    benchmark->setup();
+
+    fprintf(file, "\nslo-probe, %s %d\n", config.slo_control.c_str(), load);
+    SloProbe probe;
+    probe.load = load;
+    probe.result = run_benchmark(benchmark.get(), session, probe_config, file);
+    probe.is_compliant = probe.result.num_requests > 0 &&
+                         probe.result.latencies->percentile(99.0) <= slo_p99_ns &&
+                         (!is_rate || probe.result.rate >= SLO_DELIVERED_RATE * load);
+    probes.push_back(probe);
+
+    if (probe.is_compliant) {
+      compliant_load = load;
+    } else {
+      violating_load = load;
+    }
+
+    if (violating_load == 0) {
+      if (load >= max_load) {
+        break;
+      }
+      load = std::min(2 * load, max_load);
+    } else {
+      if (violating_load - compliant_load <= std::max(1, static_cast<int>(SLO_PRECISION * violating_load))) {
+        break;
+      }
+      load = compliant_load + (violating_load - compliant_load) / 2;
+    }
+  }
+
+  // Latencies are in microseconds
+  fprintf(file,
+          "\nslo-search (p99 <= %d us)\n"
+          "%12s, %12s, %10s, %10s, %10s, %10s\n",
+          config.slo_p99,
+          config.slo_control.c_str(), "num_requests", "rate", "99th", "max", "compliant");
+  for (const auto& probe : probes) {
+    const Histogram& latencies = *probe.result.latencies;
+    fprintf(file,
+            "%12d, %12lld, %10g, %10llu, %10llu, %10s\n",
+            probe.load, probe.result.num_requests, probe.result.rate,
+            (unsigned long long int)latencies.percentile(99.0) / 1000,
+            (unsigned long long int)latencies.max() / 1000,
+            probe.is_compliant ? "yes" : "no");
+  }
+
+  const SloProbe* best = NULL;
+  for (const auto& probe : probes) {
+    if (probe.is_compliant && (best == NULL || probe.result.rate > best->result.rate)) {
+      best = &probe;
+    }
+  }
+
+  if (best == NULL) {
+    fprintf(file, "\nslo-operating-point\nnone (no probe met the objective)\n");
+    return;
+  }
+
+  Estimate rate = estimate_rate(best->result);
+  Estimate p99 = estimate_p99(best->result);
+  fprintf(file,
+          "\nslo-operating-point\n"
+          "%12s, %10s, %10s, %10s, %10s, %10s, %10s, %10s\n"
+          "%12d, %10g, %10g, %10g, %10llu, %10g, %10g, %10zu\n",
+          config.slo_control.c_str(), "rate", "rate lower", "rate upper",
+          "99th", "99th lower", "99th upper", "samples",
+          best->load, best->result.rate, rate.lower, rate.upper,
+          (unsigned long long int)best->result.latencies->percentile(99.0) / 1000, p99.lower, p99.upper,
+          rate.count);
+}
@@ -0,0 +1,19 @@
+#ifndef SLO_SEARCH_HPP
+#define SLO_SEARCH_HPP
+
+#include "config.hpp"
+#include "driver.hpp"
+#include "prepared_cache.hpp"
+
+#include <cstdio>
+
+// Searches for the highest load (--target-rate or --num-concurrent-requests,
+// chosen by --slo-control) whose p99 latency stays within --slo-p99. The
+// load doubles until a probe violates the objective and is then bisected.
+// Each probe runs for --warmup plus --duration seconds on a single session.
+// The chosen operating point is reported with 95% confidence bounds taken
+// from its steady-state samples.
+void run_slo_search(CassSession* session, const Config& config,
+                    PreparedCache* prepared_cache, FILE* file);
+
+#endif // SLO_SEARCH_HPP
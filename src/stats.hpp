@@ -0,0 +1,67 @@
+#ifndef STATS_HPP
+#define STATS_HPP
+
+#include <cmath>
+#include <vector>
+
+// The mean of a set of observations with its sample standard deviation and
+// two-sided 95% confidence interval (from Student's t distribution)
+struct Estimate {
+  Estimate()
+    : count(0)
+    , mean(0.0)
+    , stddev(0.0)
+    , lower(0.0)
+    , upper(0.0) { }
+
+  size_t count;
+  double mean;
+  double stddev;
+  double lower;
+  double upper;
+};
+
+// Two-sided 95% critical values of Student's t distribution
+inline double t_critical_value(size_t degrees_of_freedom) {
+  static const double values[] = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+  };
+  if (degrees_of_freedom == 0) {
+    return 0.0;
+  }
+  if (degrees_of_freedom <= sizeof(values) / sizeof(values[0])) {
+    return values[degrees_of_freedom - 1];
+  }
+  return 1.960;
+}
+
+inline Estimate estimate(const std::vector<double>& values) {
+  Estimate result;
+  result.count = values.size();
+  if (values.empty()) {
+    return result;
+  }
+
+  double sum = 0.0;
+  for (double value : values) {
+    sum += value;
+  }
+  result.mean = sum / values.size();
+
+  if (values.size() > 1) {
+    double squares = 0.0;
+    for (double value : values) {
+      squares += (value - result.mean) * (value - result.mean);
+    }
+    result.stddev = std::sqrt(squares / (values.size() - 1));
+  }
+
+  double margin = t_critical_value(values.size() - 1) * result.stddev / std::sqrt(static_cast<double>(values.size()));
+  result.lower = result.mean - margin;
+  result.upper = result.mean + margin;
+  return result;
+}
+
+#endif // STATS_HPP
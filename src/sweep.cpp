@@ -0,0 +1,104 @@
+#include "sweep.hpp"
+
+#include "runner.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+struct SweepRun {
+  int num_io_threads;
+  int num_core_connections;
+  int num_threads;
+  int num_concurrent_requests;
+  RunResult result;
+};
+
+static std::vector<int> values_or(const std::vector<int>& values, int value) {
+  return values.empty() ? std::vector<int>(1, value) : values;
+}
+
+void run_sweep(const Config& config, FILE* file) {
+  std::vector<int> num_io_threads(values_or(config.sweep_num_io_threads, config.num_io_threads));
+  std::vector<int> num_core_connections(values_or(config.sweep_num_core_connections, config.num_core_connections));
+  std::vector<int> num_threads(values_or(config.sweep_num_threads, config.num_threads));
+  std::vector<int> num_concurrent_requests(values_or(config.sweep_num_concurrent_requests, config.num_concurrent_requests));
+
+  std::vector<SweepRun> runs;
+
+  for (int io_threads : num_io_threads) {
+    for (int core_connections : num_core_connections) {
+      Config cluster_config(config);
+      cluster_config.num_io_threads = io_threads;
+      cluster_config.num_core_connections = core_connections;
+      cluster_config.num_threads = *std::max_element(num_threads.begin(), num_threads.end());
+      cluster_config.num_concurrent_requests = *std::max_element(num_concurrent_requests.begin(),
+                                                                 num_concurrent_requests.end());
+
+      std::unique_ptr<CassCluster, decltype(&cass_cluster_free)> cluster(
+            create_cluster(cluster_config), cass_cluster_free);
+
+      std::unique_ptr<CassSession, decltype(&cass_session_free)> session(
+            cass_session_new(), cass_session_free);
+
+      if (connect_session(session.get(), cluster.get()) != CASS_OK) {
+        exit(-1);
+      }
+
+      PreparedCache prepared_cache(session.get());
+
+      for (int threads : num_threads) {
+        for (int concurrent_requests : num_concurrent_requests) {
+          Config run_config(config);
+          run_config.num_io_threads = io_threads;
+          run_config.num_core_connections = core_connections;
+          run_config.num_threads = threads;
+          run_config.num_concurrent_requests = concurrent_requests;
+
+          std::unique_ptr<Benchmark> benchmark(create_benchmark(session.get(), run_config));
+          benchmark->set_prepared_cache(&prepared_cache);
+          benchmark->setup();
+
+          fprintf(file,
+                  "\nsweep-run, %d io threads, %d core connections, %d threads, %d concurrent requests\n",
+                  io_threads, core_connections, threads, concurrent_requests);
+          SweepRun run;
+          run.num_io_threads = io_threads;
+          run.num_core_connections = core_connections;
+          run.num_threads = threads;
+          run.num_concurrent_requests = concurrent_requests;
+          run.result = run_benchmark(benchmark.get(), session.get(), run_config, file);
+          runs.push_back(run);
+        }
+      }
+
+      close_session(session.get());
+    }
+  }
+
+  // Latencies are in microseconds
+  fprintf(file,
+          "\nsweep\n"
+          "%10s, %16s, %11s, %19s, "
+          "%12s, %10s, "
+          "%10s, %10s, %10s, %10s, "
+          "%10s, %10s\n",
+          "io_threads", "core_connections", "num_threads", "concurrent_requests",
+          "num_requests", "rate",
+          "mean", "median", "95th", "99th",
+          "99.9th", "max");
+  for (const auto& run : runs) {
+    const Histogram& latencies = *run.result.latencies;
+    fprintf(file,
+            "%10d, %16d, %11d, %19d, "
+            "%12lld, %10g, "
+            "%10llu, %10llu, %10llu, %10llu, "
+            "%10llu, %10llu\n",
+            run.num_io_threads, run.num_core_connections, run.num_threads, run.num_concurrent_requests,
+            run.result.num_requests, run.result.rate,
+            (unsigned long long int)latencies.mean() / 1000, (unsigned long long int)latencies.percentile(50.0) / 1000,
+            (unsigned long long int)latencies.percentile(95.0) / 1000, (unsigned long long int)latencies.percentile(99.0) / 1000,
+            (unsigned long long int)latencies.percentile(99.9) / 1000, (unsigned long long int)latencies.max() / 1000);
+  }
+}
@@ -0,0 +1,15 @@
+#ifndef SWEEP_HPP
+#define SWEEP_HPP
+
+#include "config.hpp"
+
+#include <cstdio>
+
+// Runs the workload for every combination of the --sweep-* values (using
+// the regular setting for any that isn't swept) and prints one table of the
+// results. A cluster and session are only rebuilt when the IO threads or
+// core connections change. Their queues are sized for the largest threads
+// and concurrency swept, so the other values share a session.
+void run_sweep(const Config& config, FILE* file);
+
+#endif // SWEEP_HPP
@@ -0,0 +1,88 @@
+#include "trials.hpp"
+
+#include "runner.hpp"
+#include "schema.hpp"
+#include "stats.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#define NUM_PERCENTILES 7
+
+static const double PERCENTILES[NUM_PERCENTILES] = { 50.0, 75.0, 95.0, 98.0, 99.0, 99.9, 100.0 };
+static const char* PERCENTILE_NAMES[NUM_PERCENTILES] = { "median", "75th", "95th", "98th", "99th", "99.9th", "max" };
+
+static void print_variance(FILE* file, const char* metric, const std::vector<double>& values) {
+  Estimate estimate(::estimate(values));
+  double min = *std::min_element(values.begin(), values.end());
+  double max = *std::max_element(values.begin(), values.end());
+  fprintf(file,
+          "%10s, %12g, %12g, %12g, %12g, %8.2f\n",
+          metric, estimate.mean, estimate.stddev, min, max,
+          estimate.mean != 0.0 ? 100.0 * estimate.stddev / estimate.mean : 0.0);
+}
+
+void run_trials(CassSession* session, const CassCluster* cluster, const Config& config,
+                PreparedCache* prepared_cache, MockServer* mock_server, FILE* file) {
+  std::vector<RunResult> results;
+
+  for (int i = 0; i < config.repeat; ++i) {
+    if (i > 0 && config.repeat_reconnect) {
+      close_session(session);
+      if (connect_session(session, cluster) != CASS_OK) {
+        exit(-1);
+      }
+    }
+
+    std::unique_ptr<Benchmark> benchmark(create_benchmark(session, config));
+    benchmark->set_prepared_cache(prepared_cache);
+    benchmark->setup();
+
+    if (i > 0 && config.repeat_reprime) {
+      if (mock_server) {
+        mock_server->pause_workloads();
+      }
+      truncate_tables(session);
+      benchmark->prime();
+      if (mock_server) {
+        mock_server->resume_workloads();
+      }
+    }
+
+    fprintf(file, "\ntrial, %d\n", i + 1);
+    RunResult result = run_benchmark(benchmark.get(), session, config, file);
+    print_summary(benchmark.get(), session, config, result, i > 0 && !config.repeat_reconnect, file);
+    results.push_back(result);
+  }
+
+  // Latencies are in microseconds, the coefficient of variation is the
+  // standard deviation relative to the mean
+  fprintf(file,
+          "\ntrials, %d\n"
+          "%10s, %12s, %12s, %12s, %12s, %8s\n",
+          config.repeat,
+          "metric", "mean", "stddev", "min", "max", "cv %");
+
+  std::vector<double> rates;
+  for (const auto& result : results) {
+    rates.push_back(result.rate);
+  }
+  print_variance(file, "rate", rates);
+
+  std::vector<double> means;
+  for (const auto& result : results) {
+    means.push_back(result.latencies->mean() / 1000.0);
+  }
+  print_variance(file, "mean", means);
+
+  for (int p = 0; p < NUM_PERCENTILES; ++p) {
+    std::vector<double> values;
+    for (const auto& result : results) {
+      values.push_back(result.latencies->percentile(PERCENTILES[p]) / 1000.0);
+    }
+    print_variance(file, PERCENTILE_NAMES[p], values);
+  }
+}
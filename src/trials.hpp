@@ -0,0 +1,19 @@
+#ifndef TRIALS_HPP
+#define TRIALS_HPP
+
+#include "config.hpp"
+#include "driver.hpp"
+#include "mock_server.hpp"
+#include "prepared_cache.hpp"
+
+#include <cstdio>
+
+// Runs the workload --repeat times in a row and reports the mean, standard
+// deviation, min and max of the throughput and of every percentile across
+// the trials. Between trials the session can be reconnected
+// (--repeat-reconnect) and the data truncated and primed again
+// (--repeat-reprime), with the mock server's injection paused meanwhile.
+void run_trials(CassSession* session, const CassCluster* cluster, const Config& config,
+                PreparedCache* prepared_cache, MockServer* mock_server, FILE* file);
+
+#endif // TRIALS_HPP